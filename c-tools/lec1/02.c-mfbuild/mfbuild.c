@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "queue.h"
 
@@ -15,9 +17,14 @@
 #define FILE_OPENING_REFUSED	 3
 #define STRING_SPACE_REFUSED	 5
 
+#define DEFAULTNTHREADS		 4	/* include scanning worker threads */
+
 queue todos;
 queue dones;
 queue nocs;
+qindex seen;		/* every .c file name ever added to todos: as names */
+			/* only move from todos to dones or nocs, this says */
+			/* whether a name is in any of the three queues	    */
 
 /* Create a copy, in memory, of a given string.  Return a pointer to the copy.	*/
 char *copy_str_mem (char *pgivstring)
@@ -109,9 +116,12 @@ void convert_queue_to_dot_o( queue conqueue )
 /* Check whether or not we have a #include "________.h" line.
  * If we do then return pointer to name of .h file within it.
  * If we do NOT then return NULL.
+ * Any warning message is attached to the tail of *pwarnings, rather
+ * than printed, as we may be running in a scanning thread.
  */
-char *look_at_line( char *pfileline )
+char *look_at_line( char *pfileline, queue *pwarnings )
 {
+	char warning[MAXLINLEN+100];
 	char *o, *p, *q, *r;
 
 	/* copy original file line string to memory to save it for use later */
@@ -166,9 +176,10 @@ char *look_at_line( char *pfileline )
 			q = strchr(p, '"');
 			if( q != NULL )			/* " found */
 				*q = '\0';
-			fprintf (stderr,
+			sprintf( warning,
 				 "%s: Invalid include line '%s'\n",
 				 THISPROGNAME, o);
+			*pwarnings = enque( *pwarnings, copy_str_mem(warning) );
 			r = (char *) NULL;
 		}
 		else					/* .h found */
@@ -185,29 +196,25 @@ char *look_at_line( char *pfileline )
 	return r;
 }
 
-/* queue all the includes found in a given .c file.
+/* queue all the includes found in a given (open) .c file, and any
+ * warnings about them in *pwarnings.
  * Return the include queue created.
  */
-queue find_includes( char *pcfilename )
+queue find_includes( FILE *infile, queue *pwarnings )
 {
-	FILE *infile;
 	char inputline[MAXLINLEN];
 	char *pincfilename, *pmemfilename;
 	int lcv;
 
 	queue includes = new_queue();			/* start include queue */
 
-	infile = fopen( pcfilename, "r" );		/* open .c file */
-	if( infile == NULL )
-		exit( FILE_OPENING_REFUSED );		/* cannot proceed */
-
 	for( lcv = 0; fgets(inputline, MAXLINLEN-1, infile) != NULL; lcv++ )
 	{
 		/* chop off newline at end.. */
 		inputline[strlen(inputline)-1] = '\0';
 
 		/* we have a line to check */
-		pincfilename = look_at_line( inputline );  /* does it #include "__.h"? */
+		pincfilename = look_at_line( inputline, pwarnings );  /* #include "__.h"? */
 		if( pincfilename != NULL )		/* yes, it does! */
 		{
 			/* N.B. pincfilename points to .h file name
@@ -221,11 +228,149 @@ queue find_includes( char *pcfilename )
 			includes = enque( includes, pmemfilename );
 		}
 	}
-	fclose( infile );
 
 	return includes;
 }
 
+
+/* ------------------------------------------------------------------------- */
+/* Scanning .c files for includes in parallel.
+ *
+ * Every .c file name attached to the to do queue is also submitted as
+ * a scan job, and a pool of worker threads opens the files and finds
+ * their includes, in job order, as far ahead of the main loop as they
+ * can get.  The main loop then collects each job's results in exactly
+ * the order it would have scanned the files itself, so the Makefile
+ * (and any warnings) come out just as if it had.
+ */
+
+typedef struct scanjob *scanjob;
+struct scanjob {
+	char	*pcfilename;
+	bool	 done;		/* has a worker finished it? */
+	bool	 exists;	/* could the .c file be opened? */
+	queue	 includes;	/* if so, its includes */
+	queue	 warnings;	/* and any warnings about them */
+	scanjob	 next;
+};
+
+static pthread_mutex_t scanlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  scanwork = PTHREAD_COND_INITIALIZER;	/* new job, or finish */
+static pthread_cond_t  scandone = PTHREAD_COND_INITIALIZER;	/* a job is done */
+static scanjob firstjob = NULL;		/* jobs not yet collected, in order */
+static scanjob lastjob = NULL;
+static scanjob nextjob = NULL;		/* first job no worker has started */
+static bool    scanfinished = FALSE;	/* no more jobs are coming */
+
+/* Submit a .c file name for scanning. */
+void submit_scan( char *pcfilename )
+{
+	scanjob job = (scanjob) malloc( sizeof(struct scanjob) );
+	if( job == NULL )
+		exit( STRING_SPACE_REFUSED );
+	job->pcfilename = pcfilename;
+	job->done = FALSE;
+	job->includes = new_queue();
+	job->warnings = new_queue();
+	job->next = NULL;
+
+	pthread_mutex_lock( &scanlock );
+	if( lastjob == NULL )
+	{
+		firstjob = job;
+	} else
+	{
+		lastjob->next = job;
+	}
+	lastjob = job;
+	if( nextjob == NULL )
+	{
+		nextjob = job;
+	}
+	pthread_cond_signal( &scanwork );
+	pthread_mutex_unlock( &scanlock );
+}
+
+/* A worker thread: scan jobs until told to finish. */
+void *scan_worker( void *arg )
+{
+	scanjob job;
+	FILE *infile;
+
+	for(;;)
+	{
+		pthread_mutex_lock( &scanlock );
+		while( nextjob == NULL && ! scanfinished )
+		{
+			pthread_cond_wait( &scanwork, &scanlock );
+		}
+		job = nextjob;
+		if( job != NULL )
+		{
+			nextjob = job->next;
+		}
+		pthread_mutex_unlock( &scanlock );
+		if( job == NULL )
+		{
+			return NULL;
+		}
+
+		infile = fopen( job->pcfilename, "r" );	/* open .c file */
+		job->exists = infile != NULL;
+		if( infile != NULL )
+		{
+			job->includes = find_includes( infile, &job->warnings );
+			fclose( infile );
+		}
+
+		pthread_mutex_lock( &scanlock );
+		job->done = TRUE;
+		pthread_cond_broadcast( &scandone );
+		pthread_mutex_unlock( &scanlock );
+	}
+}
+
+/* Wait for the scan of the next .c file (pcfilename) to finish, print
+ * any warnings it produced and return its results: whether it exists,
+ * and its include queue.
+ */
+bool collect_scan( char *pcfilename, queue *pincludes )
+{
+	scanjob job;
+	bool exists;
+	char *warning;
+
+	pthread_mutex_lock( &scanlock );
+	job = firstjob;
+	if( job == NULL || strcmp(job->pcfilename, pcfilename) != 0 )
+	{
+		fprintf( stderr, "%s: internal error: %s was not scanned\n",
+			 THISPROGNAME, pcfilename );
+		exit( 2 );
+	}
+	while( ! job->done )
+	{
+		pthread_cond_wait( &scandone, &scanlock );
+	}
+	firstjob = job->next;
+	if( firstjob == NULL )
+	{
+		lastjob = NULL;
+	}
+	pthread_mutex_unlock( &scanlock );
+
+	while( ! queue_empty(job->warnings) )
+	{
+		warning = deque( &job->warnings );
+		fputs( warning, stderr );
+		free( warning );
+	}
+	exists = job->exists;
+	*pincludes = job->includes;
+	free( job );
+	return exists;
+}
+
 /* Write a makefile dependency line in a file. */
 void print_makeline( char *pcfilename, queue includes, FILE *outfile )
 {
@@ -289,6 +434,8 @@ char *get_main( char *parg )
 	/* tail of to do queue						*/
 	pcfilename = copy_str_mem( pmainfilename );
 	todos = enque( todos, pcfilename );
+	add_qindex( seen, pcfilename );
+	submit_scan( pcfilename );
 
 	return pmainfilename;
 }
@@ -312,15 +459,14 @@ void kill_includes_extend_todos( char *pcfilename, queue includes )
 		ifnlen = strlen(pincfilename);
 		pincfilename[ifnlen-1] = 'c';
 
-/* ---------------- text block moved left to keep it on page ! ------------------- */
-if( !in_queue (todos, pincfilename) 			/* not in to do queue */
-&&  !in_queue (dones, pincfilename) 			/* not in done queue */
-&&  !in_queue (nocs, pincfilename) 			/* not in no .c queue */
-&&  strcmp(pcfilename, pincfilename) != 0)		/* not this .c file */
-/* ------------------------------------------------------------------------------- */
+		/* not in the to do, done or no .c queues, nor this .c file */
+		if( !in_qindex( seen, pincfilename )
+		&&  strcmp(pcfilename, pincfilename) != 0 )
 		{
 			/* attach .c file name to tail of to do queue */
 			todos = enque( todos, pincfilename );
+			add_qindex( seen, pincfilename );
+			submit_scan( pincfilename );
 		}
 		else
 		{
@@ -336,7 +482,7 @@ if( !in_queue (todos, pincfilename) 			/* not in to do queue */
 }
 
 /* ------------------------------------------------------------------------- */
-/* argv[1] points to 'main' .c file name */
+/* usage: mfbuild [-j nthreads] program_name (or main .c file name) */
 int main( int argc, char **argv )
 {
 	queue includes;
@@ -344,11 +490,22 @@ int main( int argc, char **argv )
 	char *pcfilename;
 	int  mfnlen;
 	FILE *output;
+	int  nthreads = DEFAULTNTHREADS;
+	pthread_t *workers;
+	int  opt, t;
 
-	if( argc == 1 || argc > 2 )
+	while( (opt = getopt( argc, argv, "j:" )) != -1 )
+	{
+		if( opt != 'j' || (nthreads = atoi(optarg)) < 1 )
+		{
+			optind = argc;		/* force usage message */
+			break;
+		}
+	}
+	if( optind != argc-1 )
 	{
 		fprintf( stderr,
-			 "Usage: %s: program_name (or main .c file name).\n",
+			 "Usage: %s: [-j nthreads] program_name (or main .c file name).\n",
 			 THISPROGNAME);
 		exit(2);
 	}
@@ -362,6 +519,7 @@ int main( int argc, char **argv )
 	todos = new_queue();				/* start to do queue */
 	dones = new_queue();				/* start done queue */
 	nocs = new_queue();				/* start no .c queue */
+	seen = new_qindex();				/* and their index */
 
 	/* copy defsfile to makefile */
 	if( file_exists(PERSDEFSFILENAME) )	       /* personal defs file found */
@@ -373,9 +531,22 @@ int main( int argc, char **argv )
 		copy_file( LIBRDEFSFILENAME, output );
 	}
 
-	/* argv[1] points to main .c file name */
+	/* start the include scanning workers */
+	workers = (pthread_t *) malloc( nthreads * sizeof(pthread_t) );
+	if( workers == NULL )
+		exit( STRING_SPACE_REFUSED );
+	for( t = 0; t < nthreads; t++ )
+	{
+		if( pthread_create( &workers[t], NULL, scan_worker, NULL ) != 0 )
+		{
+			fprintf( stderr, "%s: can't create thread\n", THISPROGNAME );
+			exit( 2 );
+		}
+	}
+
+	/* argv[optind] points to main .c file name */
 	/* obtain main .c file name from argument and add it to to do queue */
-	pmainfilename = get_main( argv[1] );
+	pmainfilename = get_main( argv[optind] );
 
 	/* write 'BUILD' line to makefile */
 	mfnlen = strlen( pmainfilename );
@@ -396,9 +567,8 @@ int main( int argc, char **argv )
 		/* detach next .c file name from head of to do queue */
 		pcfilename = deque( &todos );
 
-		if( file_exists(pcfilename) )		/* .c file found */
+		if( collect_scan( pcfilename, &includes ) )	/* .c file found */
 		{
-			includes = find_includes( pcfilename );
 			print_makeline( pcfilename, includes, output );
 			kill_includes_extend_todos( pcfilename, includes );
 
@@ -415,6 +585,17 @@ int main( int argc, char **argv )
 	/* to do queue is now empty, so kill it */
 	free_queue( todos );
 
+	/* and so is the scan job list, so stop the workers */
+	pthread_mutex_lock( &scanlock );
+	scanfinished = TRUE;
+	pthread_cond_broadcast( &scanwork );
+	pthread_mutex_unlock( &scanlock );
+	for( t = 0; t < nthreads; t++ )
+	{
+		pthread_join( workers[t], NULL );
+	}
+	free( workers );
+
 	/* convert file names in done queue from .c to .o */
 	convert_queue_to_dot_o( dones );
 
@@ -427,6 +608,8 @@ int main( int argc, char **argv )
 
 	free_queue( nocs );
 
+	free_qindex( seen );
+
 	/* write 'prog' line to makefile */
 	fprintf( output,
 		"\n%.*s:\t\t$(OBJS)\n\t$(CC) $(OBJS) -o %.*s $(LDFLAGS)\n",
@@ -54,18 +54,25 @@ queue enque( queue q, char *s )
 
 	newnode->string = s;
 	newnode->next = NULL;
+	newnode->last = NULL;
 
 	if( queue_empty(q) )
 	{
 		q = newnode;
 	} else
 	{
-		/* find last node in queue */
-		for( last = q; last->next != NULL; last = last->next)
-			/*EMPTY*/;
+		/* the head remembers the last node, unless q is really  */
+		/* someone's tail() or was extended through one: walk then */
+		last = q->last;
+		if( last == NULL || last->next != NULL )
+		{
+			for( last = q; last->next != NULL; last = last->next)
+				/*EMPTY*/;
+		}
 		/* we are now at last node in queue */
 		last->next = newnode;
 	}
+	q->last = newnode;
 
 	return q;
 }
@@ -82,6 +89,10 @@ char *deque( queue *qp )
 	pjunknode = q;
 	retval = q->string;
 	q = q->next;
+	if( q != NULL )
+	{
+		q->last = pjunknode->last;	/* the new head */
+	}
 	free(pjunknode);
 	*qp = q;
 
@@ -113,3 +124,95 @@ queue tail( queue q )
 	assert( ! queue_empty(q) );
 	return q->next;
 }
+
+
+/* The optional hash index: open addressing, linear probing,
+   doubling when half full.					*/
+
+struct qindex {
+	char **slot;		/* NULL, or a copy of a string */
+	int    size;		/* a power of 2 */
+	int    nused;
+};
+
+#define QINDEXSIZE	64
+
+static unsigned hash_string( char *s )
+{
+	unsigned h = 2166136261u;		/* FNV-1a */
+	for( ; *s != '\0'; s++ )
+	{
+		h = (h ^ (unsigned char)*s) * 16777619u;
+	}
+	return h;
+}
+
+/* Create a new empty index */
+qindex new_qindex( void )
+{
+	qindex ix = (qindex) malloc( sizeof(struct qindex) );
+	assert( ix != NULL );
+	ix->size = QINDEXSIZE;
+	ix->nused = 0;
+	ix->slot = (char **) calloc( ix->size, sizeof(char *) );
+	assert( ix->slot != NULL );
+	return ix;
+}
+
+/* Find the slot where s is, or would go */
+static char **find_slot( char **slot, int size, char *s )
+{
+	unsigned i = hash_string(s) & (size-1);
+	while( slot[i] != NULL && strcmp(slot[i], s) != 0 )
+	{
+		i = (i+1) & (size-1);
+	}
+	return &slot[i];
+}
+
+/* Add a string to an index */
+void add_qindex( qindex ix, char *s )
+{
+	char **p = find_slot( ix->slot, ix->size, s );
+	if( *p != NULL )
+	{
+		return;					/* already there */
+	}
+	*p = strdup( s );
+	assert( *p != NULL );
+	if( ++ix->nused * 2 > ix->size )		/* grow */
+	{
+		int newsize = ix->size * 2;
+		char **newslot = (char **) calloc( newsize, sizeof(char *) );
+		assert( newslot != NULL );
+		int i;
+		for( i = 0; i < ix->size; i++ )
+		{
+			if( ix->slot[i] != NULL )
+			{
+				*find_slot( newslot, newsize, ix->slot[i] ) = ix->slot[i];
+			}
+		}
+		free( ix->slot );
+		ix->slot = newslot;
+		ix->size = newsize;
+	}
+}
+
+/* Is a given string in an index? */
+bool in_qindex( qindex ix, char *s )
+{
+	return *find_slot( ix->slot, ix->size, s ) != NULL ? TRUE : FALSE;
+}
+
+/* Free an index */
+void free_qindex( qindex ix )
+{
+	int i;
+	for( i = 0; i < ix->size; i++ )
+	{
+		free( ix->slot[i] );
+	}
+	free( ix->slot );
+	free( ix );
+}
@@ -10,6 +10,8 @@ typedef struct qnode *queue;
 struct qnode {
 		char *string;			
 		queue next;
+		queue last;	/* in the head node: the last node, so	*/
+				/* enque() needn't walk the queue	*/
 	    };
 
 	
@@ -51,3 +53,25 @@ extern char *head( queue q );
 
 extern queue tail( queue q );
 /*	Nondestructive "give me the tail of q". Abort if q is empty	*/
+
+
+/* qindex:		an optional hash index of strings, to answer
+			"is s in this queue (or these queues)?" in O(1)
+			rather than in_queue()'s linear scan.  The caller
+			adds each string it enques; the index keeps its
+			own copies of the strings.			*/
+
+typedef struct qindex *qindex;
+
+extern qindex new_qindex( void );
+/*	Creates a new empty index.					*/
+
+extern void add_qindex( qindex ix, char *s );
+/*	Add string s to the index ix.					*/
+
+extern bool in_qindex( qindex ix, char *s );
+/*	Is a given string s in the index ix?
+	Returns TRUE if string is present, FALSE otherwise.		*/
+
+extern void free_qindex( qindex ix );
+/*	Free an index							*/
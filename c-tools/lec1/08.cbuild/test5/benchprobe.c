@@ -0,0 +1,87 @@
+/*
+ * benchprobe.c: an LD_PRELOAD shim for runbench, which counts a
+ *		 program's calls to malloc(), calloc(), realloc() and
+ *		 free(), and when it exits, appends a line to the file
+ *		 named by $BENCHPROBE:
+ *
+ *		 peak_rss_kb mallocs reallocs frees
+ *
+ *		 (mallocs includes callocs).  It's not built by cb, as
+ *		 it's a shared object: runbench builds it with
+ *		 cc -shared -fPIC -O2 -o benchprobe.so benchprobe.c
+ *
+ *	The counters are updated atomically, as the programs may be
+ *	threaded.  The real allocator is glibc's, via its __libc_*
+ *	entry points, which avoids dlsym() (which itself allocates).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+extern void *__libc_malloc( size_t size );
+extern void *__libc_calloc( size_t n, size_t size );
+extern void *__libc_realloc( void *p, size_t size );
+extern void __libc_free( void *p );
+
+static unsigned long nmalloc, nrealloc, nfree;
+
+
+void *malloc( size_t size )
+{
+	__atomic_add_fetch( &nmalloc, 1, __ATOMIC_RELAXED );
+	return __libc_malloc( size );
+}
+
+void *calloc( size_t n, size_t size )
+{
+	__atomic_add_fetch( &nmalloc, 1, __ATOMIC_RELAXED );
+	return __libc_calloc( n, size );
+}
+
+void *realloc( void *p, size_t size )
+{
+	__atomic_add_fetch( &nrealloc, 1, __ATOMIC_RELAXED );
+	return __libc_realloc( p, size );
+}
+
+void free( void *p )
+{
+	if( p != NULL )
+	{
+		__atomic_add_fetch( &nfree, 1, __ATOMIC_RELAXED );
+	}
+	__libc_free( p );
+}
+
+
+__attribute__((destructor))
+static void report( void )
+{
+	char *path = getenv( "BENCHPROBE" );
+	if( path == NULL )
+	{
+		return;
+	}
+	long peak = 0;
+	FILE *st = fopen( "/proc/self/status", "r" );
+	if( st != NULL )
+	{
+		char line[256];
+		while( fgets( line, sizeof(line), st ) != NULL )
+		{
+			if( strncmp( line, "VmHWM:", 6 ) == 0 )
+			{
+				peak = atol( line + 6 );
+			}
+		}
+		fclose( st );
+	}
+	FILE *out = fopen( path, "a" );
+	if( out != NULL )
+	{
+		fprintf( out, "%ld %lu %lu %lu\n", peak, nmalloc, nrealloc, nfree );
+		fclose( out );
+	}
+}
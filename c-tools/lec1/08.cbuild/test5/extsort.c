@@ -0,0 +1,583 @@
+/*
+ *   extsort.c: gather "parent: child" pairs into families using a
+ *		bounded amount of memory, spilling sorted runs to disk.
+ *
+ *	Pairs are copied into an in-memory buffer of (roughly) the
+ *	given budget.  Whenever it fills up, the buffered pairs are
+ *	sorted by (parent, child), duplicates are dropped, and the
+ *	result is written to a temporary "run" file.  Each run is
+ *	front-coded: each string is stored as the length of the prefix
+ *	it shares with the previous record's string plus the remaining
+ *	suffix, which compresses sorted names very well.
+ *
+ *	Runs are merged by a k-way merge (using a heap of run readers),
+ *	which drops duplicates again.  Each run has a level: spilled runs
+ *	are level 0, and as soon as the newest MERGE_GROUP runs are all of
+ *	the same level they are merged into one run of the next level, like
+ *	carrying in a base MERGE_GROUP counter, so each pair is rewritten
+ *	only about log(nspills) times.  If MERGE_FANIN runs pile up anyway,
+ *	they are all merged into one, so at most MERGE_FANIN+1 run files
+ *	are ever open, however big the input.  extsortDump() then
+ *	does the final merge of the remaining runs, streaming out each
+ *	family in sorted order as it goes, in the same format as
+ *	famcollDumpSorted().  Memory use is bounded by the budget plus
+ *	one pair's worth of buffer (and one stdio buffer) per open run.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "extsort.h"
+
+
+#define	MERGE_GROUP	4	/* runs of one level merged together */
+#define	MERGE_FANIN	16	/* most runs merged (and open) at once */
+
+
+typedef struct		/* one buffered pair */
+{
+	char *parent;
+	char *child;
+} pair;
+
+typedef struct		/* a growable string */
+{
+	char *s;
+	int   len;
+	int   cap;
+} str;
+
+typedef struct		/* reads records back from one run */
+{
+	FILE *in;
+	str   parent;
+	str   child;
+} runreader;
+
+struct extsort_s
+{
+	char *	tmpdir;
+	char *	arena;		/* string storage for buffered pairs */
+	size_t	arenasize;
+	size_t	arenaused;
+	pair *	pairs;		/* the buffered pairs */
+	int	maxpairs;
+	int	npairs;
+	FILE **	runs;		/* the (unlinked) run files not yet merged */
+	int *	level;		/* their levels, oldest (biggest) first */
+	int	nruns;		/* < MERGE_FANIN between spills */
+};
+
+
+/*
+ * extsort e = extsortCreate( budget, tmpdir );
+ *	Create an external sorter that buffers up to (about) budget
+ *	bytes of pairs before spilling a run to a file in tmpdir.
+ */
+extsort extsortCreate( size_t budget, char *tmpdir )
+{
+	extsort e = (extsort) malloc( sizeof(struct extsort_s) );
+	assert( e != NULL );
+	if( budget < 4096 )
+	{
+		budget = 4096;
+	}
+	e->tmpdir = strdup( tmpdir );
+	e->arenasize = budget / 4 * 3;
+	e->arena = (char *) malloc( e->arenasize );
+	assert( e->arena != NULL );
+	e->arenaused = 0;
+	e->maxpairs = budget / 4 / sizeof(pair);
+	e->pairs = (pair *) malloc( e->maxpairs * sizeof(pair) );
+	assert( e->pairs != NULL );
+	e->npairs = 0;
+	e->runs = (FILE **) malloc( MERGE_FANIN * sizeof(FILE *) );
+	e->level = (int *) malloc( MERGE_FANIN * sizeof(int) );
+	assert( e->runs != NULL && e->level != NULL );
+	e->nruns = 0;
+	return e;
+}
+
+
+static int paircmp( const void *a, const void *b )
+{
+	const pair *x = (const pair *)a;
+	const pair *y = (const pair *)b;
+	int rc = strcmp( x->parent, y->parent );
+	return rc != 0 ? rc : strcmp( x->child, y->child );
+}
+
+
+/* a merge callback is called by mergeruns() once per distinct record,
+ * in sorted order, with the previous record (NULLs for the first)
+ */
+typedef void (*mergecb)( char *parent, char *child,
+	char *prevparent, char *prevchild, void *arg );
+
+
+static void putvarint( FILE *out, unsigned int n )
+{
+	while( n >= 0x80 )
+	{
+		putc( (n & 0x7f) | 0x80, out );
+		n >>= 7;
+	}
+	putc( n, out );
+}
+
+
+/*
+ * badrun( in );
+ *	Complain that we couldn't read run in back: it's either
+ *	unreadable or not what we wrote (eg. truncated), and exit.
+ */
+static void badrun( FILE *in )
+{
+	if( ferror( in ) )
+	{
+		fprintf( stderr, "extsort: can't read run file: %s\n",
+			strerror( errno ) );
+	} else
+	{
+		fprintf( stderr, "extsort: corrupt run file\n" );
+	}
+	exit(1);
+}
+
+
+/*
+ * bool ok = getvarint( in, &n );
+ *	Read a varint from in into n.  Return false at a clean EOF (before
+ *	any of it); a read error or a partial varint is fatal.
+ */
+static bool getvarint( FILE *in, unsigned int *n )
+{
+	int ch;
+	int shift = 0;
+	*n = 0;
+	while( (ch = getc( in )) != EOF && shift <= 28 )
+	{
+		*n |= (unsigned int)(ch & 0x7f) << shift;
+		if( (ch & 0x80) == 0 )
+		{
+			return true;
+		}
+		shift += 7;
+	}
+	if( shift > 0 || ferror( in ) )
+	{
+		badrun( in );
+	}
+	return false;
+}
+
+
+/*
+ * putfront( out, s, prev );
+ *	Write s front-coded against prev: shared prefix length,
+ *	suffix length, suffix.
+ */
+static void putfront( FILE *out, char *s, char *prev )
+{
+	int shared = 0;
+	if( prev != NULL )
+	{
+		while( s[shared] != '\0' && s[shared] == prev[shared] )
+		{
+			shared++;
+		}
+	}
+	int rest = strlen( s+shared );
+	putvarint( out, shared );
+	putvarint( out, rest );
+	fwrite( s+shared, 1, rest, out );
+}
+
+
+/*
+ * bool ok = getfront( in, s );
+ *	Read a front-coded string from in, replacing the end of s (the
+ *	previous string) with the new suffix.  Return false at a clean
+ *	EOF; anything that isn't a whole valid string is fatal.
+ */
+static bool getfront( FILE *in, str *s )
+{
+	unsigned int shared, rest;
+	if( ! getvarint( in, &shared ) )
+	{
+		return false;
+	}
+	if( ! getvarint( in, &rest ) || shared > (unsigned int)s->len ||
+	    rest > 0x3fffffff )
+	{
+		badrun( in );
+	}
+	if( shared + rest + 1 > s->cap )
+	{
+		s->cap = (shared + rest + 1) * 2;
+		s->s = (char *) realloc( s->s, s->cap );
+		assert( s->s != NULL );
+	}
+	if( fread( s->s + shared, 1, rest, in ) != rest )
+	{
+		badrun( in );
+	}
+	s->len = shared + rest;
+	s->s[s->len] = '\0';
+	return true;
+}
+
+
+/*
+ * strcopy( dst, src );
+ *	dst = src, growing dst if necessary.
+ */
+static void strcopy( str *dst, str *src )
+{
+	if( src->len + 1 > dst->cap )
+	{
+		dst->cap = (src->len + 1) * 2;
+		dst->s = (char *) realloc( dst->s, dst->cap );
+		assert( dst->s != NULL );
+	}
+	memcpy( dst->s, src->s, src->len + 1 );
+	dst->len = src->len;
+}
+
+
+/*
+ * endrun( e, out );
+ *	Finish writing run out: flush it, and exit if any write to it
+ *	failed (eg. tmpdir is full), rather than merge a truncated run.
+ */
+static void endrun( extsort e, FILE *out )
+{
+	if( fflush( out ) != 0 || ferror( out ) )
+	{
+		fprintf( stderr, "extsort: can't write run file in %s: %s\n",
+			e->tmpdir, strerror( errno ) );
+		exit(1);
+	}
+}
+
+
+/*
+ * FILE *out = newrun( e );
+ *	Create a new, empty, run file in e's tmpdir, open for writing
+ *	and then reading back.  It's unlinked at once, so it vanishes
+ *	when closed.
+ */
+static FILE *newrun( extsort e )
+{
+	char template[1024];
+	snprintf( template, sizeof(template), "%s/extsortXXXXXX", e->tmpdir );
+	int fd = mkstemp( template );
+	if( fd == -1 )
+	{
+		fprintf( stderr, "extsort: can't create temp file in %s: %s\n",
+			e->tmpdir, strerror( errno ) );
+		exit(1);
+	}
+	unlink( template );		/* vanishes when closed */
+	FILE *out = fdopen( fd, "w+" );
+	assert( out != NULL );
+	return out;
+}
+
+
+static void mergeruns( FILE **runs, int n, mergecb cb, void *arg );
+
+
+/*
+ * writerun_cb( parent, child, prevparent, prevchild, out );
+ *	A merge callback: append the record (parent, child) to run
+ *	out, front-coded against the previous record.
+ */
+static void writerun_cb( char *parent, char *child,
+	char *prevparent, char *prevchild, void *out )
+{
+	putfront( (FILE *)out, parent, prevparent );
+	putfront( (FILE *)out, child, prevchild );
+}
+
+
+/*
+ * compact( e );
+ *	Merge e's newest runs while the newest MERGE_GROUP of them are of
+ *	the same level, and merge all of them if there are MERGE_FANIN,
+ *	leaving fewer than MERGE_FANIN runs.  Levels never increase from
+ *	oldest to newest, so the merged run's level is one more than the
+ *	oldest level merged.
+ */
+static void compact( extsort e )
+{
+	while( e->nruns > 1 )
+	{
+		int first = e->nruns - 1;
+		while( first > 0 && e->level[first-1] == e->level[e->nruns-1] )
+		{
+			first--;
+		}
+		if( e->nruns - first < MERGE_GROUP )
+		{
+			if( e->nruns < MERGE_FANIN )
+			{
+				break;
+			}
+			first = 0;
+		}
+
+		FILE *out = newrun( e );
+		mergeruns( e->runs + first, e->nruns - first, &writerun_cb, (void *)out );
+		endrun( e, out );
+		int i;
+		for( i = first; i < e->nruns; i++ )
+		{
+			fclose( e->runs[i] );
+		}
+		e->runs[first] = out;
+		e->level[first]++;
+		e->nruns = first + 1;
+	}
+}
+
+
+/*
+ * spill( e );
+ *	Sort and dedupe the buffered pairs, write them out as a new
+ *	level 0 run, and merge runs as need be.
+ */
+static void spill( extsort e )
+{
+	if( e->npairs == 0 )
+	{
+		return;
+	}
+	qsort( e->pairs, e->npairs, sizeof(pair), &paircmp );
+
+	FILE *out = newrun( e );
+	pair *prev = NULL;
+	int i;
+	for( i = 0; i < e->npairs; i++ )
+	{
+		pair *p = &e->pairs[i];
+		if( prev != NULL && paircmp( prev, p ) == 0 )
+		{
+			continue;
+		}
+		putfront( out, p->parent, prev == NULL ? NULL : prev->parent );
+		putfront( out, p->child, prev == NULL ? NULL : prev->child );
+		prev = p;
+	}
+	endrun( e, out );
+
+	e->runs[e->nruns] = out;
+	e->level[e->nruns++] = 0;
+	e->npairs = 0;
+	e->arenaused = 0;
+	compact( e );
+}
+
+
+/*
+ * extsortAdd( e, parent, child );
+ *	Add the pair (parent, child), spilling a run first if there's
+ *	no room for it in the buffer.
+ */
+void extsortAdd( extsort e, char *parent, char *child )
+{
+	size_t pl = strlen( parent ) + 1;
+	size_t cl = strlen( child ) + 1;
+	if( e->npairs == e->maxpairs || e->arenaused + pl + cl > e->arenasize )
+	{
+		spill( e );
+	}
+	if( pl + cl > e->arenasize )	/* one enormous pair */
+	{
+		e->arenasize = pl + cl;
+		free( (void *)e->arena );
+		e->arena = (char *) malloc( e->arenasize );
+		assert( e->arena != NULL );
+	}
+	pair *p = &e->pairs[e->npairs++];
+	p->parent = e->arena + e->arenaused;
+	memcpy( p->parent, parent, pl );
+	p->child = p->parent + pl;
+	memcpy( p->child, child, cl );
+	e->arenaused += pl + cl;
+}
+
+
+/* the merge heap: a binary min-heap of run readers, by (parent,child) */
+
+static int readercmp( runreader *a, runreader *b )
+{
+	int rc = strcmp( a->parent.s, b->parent.s );
+	return rc != 0 ? rc : strcmp( a->child.s, b->child.s );
+}
+
+
+static void siftdown( runreader **heap, int n, int i )
+{
+	for(;;)
+	{
+		int smallest = i;
+		int l = 2*i+1;
+		int r = l+1;
+		if( l < n && readercmp( heap[l], heap[smallest] ) < 0 )
+		{
+			smallest = l;
+		}
+		if( r < n && readercmp( heap[r], heap[smallest] ) < 0 )
+		{
+			smallest = r;
+		}
+		if( smallest == i )
+		{
+			break;
+		}
+		runreader *t = heap[i];
+		heap[i] = heap[smallest];
+		heap[smallest] = t;
+		i = smallest;
+	}
+}
+
+
+static bool nextrecord( runreader *r )
+{
+	if( ! getfront( r->in, &r->parent ) )
+	{
+		return false;
+	}
+	if( ! getfront( r->in, &r->child ) )
+	{
+		badrun( r->in );	/* a parent without a child */
+	}
+	return true;
+}
+
+
+/*
+ * mergeruns( runs, n, cb, arg );
+ *	Merge the n runs[0..n-1] (reading each from the start), and call
+ *	cb( parent, child, prevparent, prevchild, arg ) for each distinct
+ *	record in sorted order of parent and then child.
+ */
+static void mergeruns( FILE **runs, int n, mergecb cb, void *arg )
+{
+	runreader *reader = (runreader *) calloc( n+1, sizeof(runreader) );
+	runreader **heap = (runreader **) malloc( (n+1)*sizeof(runreader *) );
+	assert( reader != NULL && heap != NULL );
+	int nheap = 0;
+	int i;
+	for( i = 0; i < n; i++ )
+	{
+		rewind( runs[i] );
+		reader[i].in = runs[i];
+		if( nextrecord( &reader[i] ) )
+		{
+			heap[nheap++] = &reader[i];
+		}
+	}
+	for( i = nheap/2-1; i >= 0; i-- )
+	{
+		siftdown( heap, nheap, i );
+	}
+
+	str parent = { NULL, 0, 0 };	/* the last record passed to cb */
+	str child = { NULL, 0, 0 };
+	while( nheap > 0 )
+	{
+		runreader *r = heap[0];
+		if( parent.s == NULL || strcmp( parent.s, r->parent.s ) != 0 ||
+		    strcmp( child.s, r->child.s ) != 0 )
+		{
+			(*cb)( r->parent.s, r->child.s, parent.s, child.s, arg );
+			strcopy( &parent, &r->parent );
+			strcopy( &child, &r->child );
+		}
+
+		if( ! nextrecord( r ) )
+		{
+			heap[0] = heap[--nheap];
+		}
+		siftdown( heap, nheap, 0 );
+	}
+
+	free( (void *)parent.s );
+	free( (void *)child.s );
+	for( i = 0; i < n; i++ )
+	{
+		free( (void *)reader[i].parent.s );
+		free( (void *)reader[i].child.s );
+	}
+	free( (void *)reader );
+	free( (void *)heap );
+}
+
+
+/*
+ * extsortDump( out, e );
+ *	Merge all the pairs added to e, and display each family, in
+ *	sorted order of parent and then child, to out, in the same
+ *	format as famcollDumpSorted().
+ */
+typedef struct { FILE *out; int nfamilies; } dumparg;
+static void printpair_cb( char *parent, char *child,
+	char *prevparent, char *prevchild, void *arg )
+{
+	dumparg *da = (dumparg *)arg;
+	if( prevparent == NULL || strcmp( prevparent, parent ) != 0 )
+	{
+		if( prevparent != NULL )
+		{
+			fputc( '\n', da->out );
+		}
+		fprintf( da->out, "%s: %s", parent, child );
+		da->nfamilies++;
+	} else
+	{
+		fprintf( da->out, ",%s", child );
+	}
+}
+void extsortDump( FILE *out, extsort e )
+{
+	spill( e );		/* the last, partial, run */
+	compact( e );
+
+	dumparg da; da.out = out; da.nfamilies = 0;
+	fputc( '\n', out );
+	mergeruns( e->runs, e->nruns, &printpair_cb, (void *)&da );
+	if( da.nfamilies > 0 )
+	{
+		fputc( '\n', out );
+	}
+	fputc( '\n', out );
+	fprintf( out, "There are %d families\n", da.nfamilies );
+}
+
+
+/*
+ * extsortFree( e );
+ *	Free e, closing (and hence deleting) its run files.
+ */
+void extsortFree( extsort e )
+{
+	int i;
+	for( i = 0; i < e->nruns; i++ )
+	{
+		fclose( e->runs[i] );
+	}
+	free( (void *)e->runs );
+	free( (void *)e->level );
+	free( (void *)e->pairs );
+	free( (void *)e->arena );
+	free( (void *)e->tmpdir );
+	free( (void *)e );
+}
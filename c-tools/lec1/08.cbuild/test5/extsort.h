@@ -0,0 +1,11 @@
+/*
+ *   extsort.h: gather "parent: child" pairs into families using a
+ *		bounded amount of memory, spilling sorted runs to disk.
+ */
+
+typedef struct extsort_s *extsort;
+
+extern extsort extsortCreate( size_t budget, char * tmpdir );
+extern void extsortAdd( extsort e, char * parent, char * child );
+extern void extsortDump( FILE * out, extsort e );
+extern void extsortFree( extsort e );
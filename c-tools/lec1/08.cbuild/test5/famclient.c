@@ -0,0 +1,378 @@
+/*
+ * famclient.c: a client library for famserver: connect to its UNIX
+ *		domain socket and query the family collection it serves,
+ *		using the protocol described in famproto.h.
+ *
+ *	Each query function returns -1 if anything goes wrong talking
+ *	to the server (after which the connection is unusable, and
+ *	should be fcClose()d).  fcIsChildBatch() asks many questions in
+ *	one request, and fcPipelineIsChild() sends many single requests
+ *	at once before reading any of the answers: both save a round
+ *	trip per question.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "famproto.h"
+#include "famclient.h"
+
+
+struct famclient_s
+{
+	int	fd;
+	char *	out;		/* requests not yet sent */
+	int	outlen;
+	int	outcap;
+	char *	in;		/* the current response */
+	int	inlen;		/* its length */
+	int	incap;
+	int	inpos;		/* how much of it we've taken */
+};
+
+
+/*
+ * famclient c = fcConnect( path );
+ *	Connect to the famserver listening on UNIX domain socket path.
+ *	Return NULL (with errno set) if we can't.
+ */
+famclient fcConnect( char *path )
+{
+	struct sockaddr_un addr;
+	if( strlen(path) >= sizeof(addr.sun_path) )
+	{
+		return NULL;
+	}
+	int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if( fd < 0 )
+	{
+		return NULL;
+	}
+	memset( &addr, 0, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+	strcpy( addr.sun_path, path );
+	if( connect( fd, (struct sockaddr *)&addr, sizeof(addr) ) < 0 )
+	{
+		close( fd );
+		return NULL;
+	}
+	famclient c = (famclient) calloc( 1, sizeof(struct famclient_s) );
+	assert( c != NULL );
+	c->fd = fd;
+	return c;
+}
+
+
+/*
+ * fcClose( c );
+ *	Disconnect, and free c.
+ */
+void fcClose( famclient c )
+{
+	close( c->fd );
+	free( c->out );
+	free( c->in );
+	free( (void *)c );
+}
+
+
+static void put( famclient c, void *p, int len )
+{
+	if( c->outlen + len > c->outcap )
+	{
+		c->outcap = (c->outlen + len) * 2;
+		c->out = realloc( c->out, c->outcap );
+		assert( c->out != NULL );
+	}
+	memcpy( c->out + c->outlen, p, len );
+	c->outlen += len;
+}
+
+static void putu32( famclient c, uint32_t x )
+{
+	put( c, &x, 4 );
+}
+
+static void putstr( famclient c, char *s )
+{
+	uint32_t len = strlen( s );
+	putu32( c, len );
+	put( c, s, len );
+}
+
+
+/*
+ * int start = begin( c, op );
+ *	Start a request frame with opcode op, returning where its length
+ *	goes, for end() to fill in.
+ */
+static int begin( famclient c, int op )
+{
+	int start = c->outlen;
+	putu32( c, 0 );
+	unsigned char b = op;
+	put( c, &b, 1 );
+	return start;
+}
+
+static void end( famclient c, int start )
+{
+	uint32_t len = c->outlen - start - 4;
+	memcpy( c->out + start, &len, 4 );
+}
+
+
+/*
+ * bool ok = flush( c );
+ *	Send all the requests built up so far.
+ */
+static bool flush( famclient c )
+{
+	char *p = c->out;
+	int left = c->outlen;
+	while( left > 0 )
+	{
+		ssize_t n = write( c->fd, p, left );
+		if( n <= 0 )
+		{
+			return false;
+		}
+		p += n;
+		left -= n;
+	}
+	c->outlen = 0;
+	return true;
+}
+
+
+static bool readfull( int fd, char *p, int len )
+{
+	while( len > 0 )
+	{
+		ssize_t n = read( fd, p, len );
+		if( n <= 0 )
+		{
+			return false;
+		}
+		p += n;
+		len -= n;
+	}
+	return true;
+}
+
+
+/*
+ * bool ok = response( c );
+ *	Read the next response frame, and check its status.
+ */
+static bool response( famclient c )
+{
+	uint32_t len;
+	if( ! readfull( c->fd, (char *)&len, 4 ) || len < 1 || len > FAM_MAXFRAME )
+	{
+		return false;
+	}
+	if( len > c->incap )
+	{
+		c->incap = len * 2;
+		c->in = realloc( c->in, c->incap );
+		assert( c->in != NULL );
+	}
+	if( ! readfull( c->fd, c->in, len ) )
+	{
+		return false;
+	}
+	c->inlen = len;
+	c->inpos = 1;
+	return c->in[0] == FAM_OK;
+}
+
+
+static bool getbytes( famclient c, void *p, int len )
+{
+	if( c->inpos + len > c->inlen )
+	{
+		return false;
+	}
+	memcpy( p, c->in + c->inpos, len );
+	c->inpos += len;
+	return true;
+}
+
+
+/*
+ * int n = names( c, cb, arg );
+ *	Take a count and that many strings from the current response,
+ *	calling cb( name, arg ) for each, and return the count, or -1.
+ */
+static int names( famclient c, fcnamecb cb, void *arg )
+{
+	uint32_t count;
+	if( ! getbytes( c, &count, 4 ) )
+	{
+		return -1;
+	}
+	char *name = NULL;
+	uint32_t i;
+	for( i = 0; i < count; i++ )
+	{
+		uint32_t len;
+		if( ! getbytes( c, &len, 4 ) || c->inpos + len > c->inlen )
+		{
+			free( name );
+			return -1;
+		}
+		name = realloc( name, len + 1 );
+		assert( name != NULL );
+		getbytes( c, name, len );
+		name[len] = '\0';
+		if( cb != NULL )
+		{
+			(*cb)( name, arg );
+		}
+	}
+	free( name );
+	return count;
+}
+
+
+/*
+ * int ischild = fcIsChild( c, parent, child );
+ *	Is child a child of parent?  1 for yes, 0 for no, -1 for error.
+ */
+int fcIsChild( famclient c, char *parent, char *child )
+{
+	int start = begin( c, FAM_ISCHILD );
+	putstr( c, parent );
+	putstr( c, child );
+	end( c, start );
+	unsigned char b;
+	if( ! flush( c ) || ! response( c ) || ! getbytes( c, &b, 1 ) )
+	{
+		return -1;
+	}
+	return b;
+}
+
+
+/*
+ * int n = fcNFamilies( c );
+ *	How many families are there?  -1 for error.
+ */
+int fcNFamilies( famclient c )
+{
+	end( c, begin( c, FAM_NFAMILIES ) );
+	uint32_t n;
+	if( ! flush( c ) || ! response( c ) || ! getbytes( c, &n, 4 ) )
+	{
+		return -1;
+	}
+	return n;
+}
+
+
+/*
+ * int n = fcChildren( c, parent, cb, arg );
+ *	Call cb( child, arg ) for each of parent's children, in sorted
+ *	order, and return how many there are (0 if parent has no family),
+ *	or -1 for error.  Each name is only valid during its callback.
+ */
+int fcChildren( famclient c, char *parent, fcnamecb cb, void *arg )
+{
+	int start = begin( c, FAM_CHILDREN );
+	putstr( c, parent );
+	end( c, start );
+	if( ! flush( c ) || ! response( c ) )
+	{
+		return -1;
+	}
+	return names( c, cb, arg );
+}
+
+
+/*
+ * int n = fcParents( c, child, cb, arg );
+ *	Call cb( parent, arg ) for each of child's parents, and return
+ *	how many there are, or -1 for error.
+ */
+int fcParents( famclient c, char *child, fcnamecb cb, void *arg )
+{
+	int start = begin( c, FAM_PARENTS );
+	putstr( c, child );
+	end( c, start );
+	if( ! flush( c ) || ! response( c ) )
+	{
+		return -1;
+	}
+	return names( c, cb, arg );
+}
+
+
+/*
+ * int rc = fcIsChildBatch( c, n, parents, children, results );
+ *	Ask whether each children[i] is a child of parents[i], for i
+ *	in 0..n-1, in a single request, setting results[i].  Return 0,
+ *	or -1 for error.
+ */
+int fcIsChildBatch( famclient c, int n, char **parents, char **children,
+	bool *results )
+{
+	int start = begin( c, FAM_ISCHILDBATCH );
+	putu32( c, n );
+	int i;
+	for( i = 0; i < n; i++ )
+	{
+		putstr( c, parents[i] );
+		putstr( c, children[i] );
+	}
+	end( c, start );
+	if( ! flush( c ) || ! response( c ) || c->inlen - c->inpos != n )
+	{
+		return -1;
+	}
+	for( i = 0; i < n; i++ )
+	{
+		results[i] = c->in[c->inpos + i] != 0;
+	}
+	return 0;
+}
+
+
+/*
+ * int rc = fcPipelineIsChild( c, n, parents, children, results );
+ *	Like fcIsChildBatch(), but send n separate FAM_ISCHILD requests
+ *	in one write, and then read the n responses.
+ */
+int fcPipelineIsChild( famclient c, int n, char **parents, char **children,
+	bool *results )
+{
+	int i;
+	for( i = 0; i < n; i++ )
+	{
+		int start = begin( c, FAM_ISCHILD );
+		putstr( c, parents[i] );
+		putstr( c, children[i] );
+		end( c, start );
+	}
+	if( ! flush( c ) )
+	{
+		return -1;
+	}
+	for( i = 0; i < n; i++ )
+	{
+		unsigned char b;
+		if( ! response( c ) || ! getbytes( c, &b, 1 ) )
+		{
+			return -1;
+		}
+		results[i] = b != 0;
+	}
+	return 0;
+}
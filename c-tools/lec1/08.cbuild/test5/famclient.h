@@ -0,0 +1,18 @@
+/*
+ * famclient.h: a client library for famserver: connect to its UNIX
+ *		domain socket and query the family collection it serves.
+ */
+
+typedef struct famclient_s *famclient;
+
+/* a famclient name callback is called once per name in a result */
+typedef void (*fcnamecb)( char * name, void * arg );
+
+extern famclient fcConnect( char * path );
+extern void fcClose( famclient c );
+extern int fcIsChild( famclient c, char * parent, char * child );
+extern int fcNFamilies( famclient c );
+extern int fcChildren( famclient c, char * parent, fcnamecb cb, void * arg );
+extern int fcParents( famclient c, char * child, fcnamecb cb, void * arg );
+extern int fcIsChildBatch( famclient c, int n, char ** parents, char ** children, bool * results );
+extern int fcPipelineIsChild( famclient c, int n, char ** parents, char ** children, bool * results );
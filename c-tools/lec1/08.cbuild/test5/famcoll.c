@@ -10,8 +10,14 @@
  *	together.
  *
  *	We store this as a parent -> set(child) collection;
- *      actually, a hash from a string (the parent name) to a set of
- *	other strings (the names of the children of that parent).
+ *      actually, a multimap from a string (the parent name) to the
+ *	other strings (the names of the children of that parent), which
+ *	keeps each parent's children in one contiguous vector of interned
+ *	name ids.  Callers can iterate over those vectors directly, with
+ *	famcollForeachChild(); the real sets of children that
+ *	famcollChildren() and famcollForeach() hand out are built only
+ *	on request, in one scratch set (or one per family), so f never
+ *	keeps a set per parent.
  *
  * (C) Duncan C. White, May 2017
  */
@@ -22,90 +28,503 @@
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include <hash.h>
 #include <set.h>
+#include <multimap.h>
+#include <sketch.h>
+#include <strsort.h>
 
 #include "famcoll.h"
+#include "famreach.h"
+#include "famfrozen.h"
+#include "famlog.h"
+#include "famstats.h"
 
 
-struct famcoll_s	/* a family collection is simply a hash of sets */
+struct famcoll_s	/* a family collection is simply a multimap */
 			/* with some meta-data */
 {
 	int nfamilies;
-	hash f;
+	multimap m;		/* parent -> children, NULL once frozen */
+	famfrozen frozen;	/* NULL until frozen */
+	hash sketches;		/* parent -> famsketch, NULL unless enabled */
+	multimap parents;	/* child -> parents, NULL unless enabled */
+	famreach reach;		/* NULL until the first reachability query */
+	famlog log;		/* NULL unless opened by famcollOpen */
+	famstats stats;		/* NULL unless enabled */
+	set kids;		/* famcollChildren()'s answer, NULL until then */
+	set parentset;		/* famcollParents()'s answer, NULL until then */
 };
 
 
-static void printV( FILE *out, hashkey parent, hashvalue v )
+typedef struct			/* the optional sketches of one family */
 {
-	set s = (set)v;
-	fprintf( out, "%s: ", parent );
-	bool empty = setIsEmpty( s );
-	if( empty )
-	{
-		fprintf( out, "empty" );
-	} else
-	{
-		//fprintf( out, "children: " );
-		setDump( out, s );
-	}
-	fprintf( out, "\n" );
+	minhash m;		/* for similarity of child sets */
+	hll h;			/* for distinct counts of child sets */
+} famsketch;
+
+
+#define	LSH_BANDS	16	/* LSH_BANDS*LSH_ROWS <= MINHASH_K */
+#define	LSH_ROWS	4
+
+
+/* a pair callback is called by foreachpair() once per (parent, child) */
+typedef void (*paircb)( char *parent, char *child, void *arg );
+
+static void foreachparent( famcoll f, famfrozenparentcb cb, void *arg );
+static void foreachpair( famcoll f, paircb cb, void *arg );
+
+
+static hashvalue copySketch( hashvalue v )
+{
+	famsketch *old = (famsketch *)v;
+	famsketch *new = (famsketch *) malloc( sizeof(famsketch) );
+	assert( new != NULL );
+	new->m = minhashCopy( old->m );
+	new->h = hllCopy( old->h );
+	return (hashvalue) new;
 }
 
 
-static hashvalue copyV( hashvalue v )
+static void freeSketch( hashvalue v )
 {
-	return (hashvalue) setCopy( (set)v );
+	famsketch *fs = (famsketch *)v;
+	minhashFree( fs->m );
+	hllFree( fs->h );
+	free( (void *)fs );
 }
 
 
-static void freeV( hashvalue v )
+/*
+ * viewadd_cb( k, s );
+ *	A foreach callback: add k to set s, for building sets on demand.
+ */
+static void viewadd_cb( setkey k, void *arg )
 {
-	setFree( (set)v );
+	setAdd( (set)arg, k );
 }
 
 
 /*
  * famcoll f = famcollCreate();
- *	Create a family collection: a hash of sets.
+ *	Create a family collection: a multimap.
  */
 famcoll famcollCreate( void )
 {
 	famcoll new = (famcoll) malloc( sizeof(struct famcoll_s));
 	assert( new != NULL );
-	new->f = hashCreate( &printV, &freeV, &copyV );
+	new->m = mmCreate();
 	new->nfamilies = 0;
+	new->frozen = NULL;
+	new->sketches = NULL;
+	new->parents = NULL;
+	new->reach = NULL;
+	new->log = NULL;
+	new->stats = NULL;
+	new->kids = NULL;
+	new->parentset = NULL;
 	return new;
 }
 
 
+/*
+ * famcoll f = famcollOpen( dir );
+ *	Create a persistent family collection, stored in directory dir
+ *	(which must exist; see famlog.c): its families are loaded from
+ *	dir's latest snapshot plus the log of pairs added since then, and
+ *	every new pair added to f is appended to that log.  A new snapshot
+ *	is taken by famcollSnapshot(), or automatically whenever the log
+ *	has grown as big as the last snapshot, so restarting costs time
+ *	proportional to the snapshot plus the recent additions, not to
+ *	the original input.
+ */
+static void replay_cb( char *parent, char *child, void *arg )
+{
+	famcollAddChild( (famcoll)arg, parent, child );
+}
+famcoll famcollOpen( char *dir )
+{
+	famcoll f = famcollCreate();
+	f->log = famlogOpen( dir, &replay_cb, (void *)f );
+	return f;
+}
+
+
 /*
  * famcollFree( f );
  *	Free a famcoll
  */
 void famcollFree( famcoll f )
 {
-	hashFree( f->f );
+	if( f->frozen != NULL )
+	{
+		famfrozenFree( f->frozen );
+	} else
+	{
+		mmFree( f->m );
+	}
+	if( f->sketches != NULL )
+	{
+		hashFree( f->sketches );
+	}
+	if( f->parents != NULL )
+	{
+		mmFree( f->parents );
+	}
+	if( f->reach != NULL )
+	{
+		famreachFree( f->reach );
+	}
+	if( f->log != NULL )
+	{
+		famlogClose( f->log );
+	}
+	if( f->stats != NULL )
+	{
+		famstatsFree( f->stats );
+	}
+	if( f->kids != NULL )
+	{
+		setFree( f->kids );
+	}
+	if( f->parentset != NULL )
+	{
+		setFree( f->parentset );
+	}
 	free( (void *)f );
 }
 
 
+/*
+ * famcollMerge( dst, src );
+ *	Merge all of src's families into dst, leaving src empty.  A family
+ *	whose parent is new to dst has its child vector moved across, not
+ *	copied (though each distinct name new to dst is copied into it
+ *	once); a parent in both gets the union of their children.  Both
+ *	must have sketches enabled, or neither (sketches are merged too),
+ *	and the same for reverse indexes and statistics.  Both
+ *	collections' reachability information is
+ *	discarded, to be rebuilt by the next reachability query.  If dst
+ *	is persistent, src's pairs are appended to its log, and dst is
+ *	snapshotted afterwards if the log has grown big enough.
+ *	Precondition: neither is frozen, and src is not persistent
+ */
+static void logpair_cb( char *parent, char *child, void *arg )
+{
+	famlogAppend( (famlog)arg, parent, child );
+}
+static void mergestats_cb( char *parent, int index, int oldn, int newn, void *arg )
+{
+	if( newn > oldn )
+	{
+		famstatsUpdate( (famstats)arg, index, parent, oldn, newn );
+	}
+}
+static void mergesketch_cb( hashkey parent, hashvalue v, void *arg )
+{
+	hash dst = (hash)arg;
+	famsketch *from = (famsketch *)v;
+	famsketch *to = (famsketch *)hashFind( dst, parent );
+	if( to == NULL )	/* steal from's sketches, leaving an empty shell */
+	{
+		to = (famsketch *) malloc( sizeof(famsketch) );
+		assert( to != NULL );
+		to->m = from->m;
+		to->h = from->h;
+		from->m = NULL;
+		from->h = NULL;
+		hashSet( dst, parent, (hashvalue)to );
+	} else
+	{
+		minhashMerge( to->m, from->m );
+		hllMerge( to->h, from->h );
+	}
+}
+void famcollMerge( famcoll dst, famcoll src )
+{
+	assert( (dst->sketches == NULL) == (src->sketches == NULL) );
+	assert( (dst->parents == NULL) == (src->parents == NULL) );
+	assert( (dst->stats == NULL) == (src->stats == NULL) );
+	assert( dst->frozen == NULL && src->frozen == NULL );
+	assert( src->log == NULL );
+	if( dst->log != NULL )
+	{
+		foreachpair( src, &logpair_cb, (void *)dst->log );
+	}
+
+	mmMerge( dst->m, src->m,
+		 dst->stats != NULL ? &mergestats_cb : NULL, (void *)dst->stats );
+	dst->nfamilies = mmNKeys( dst->m );
+	src->nfamilies = 0;
+	if( src->stats != NULL )
+	{
+		famstatsEmpty( src->stats );
+	}
+
+	if( src->sketches != NULL )
+	{
+		hashForeach( src->sketches, &mergesketch_cb, (void *)dst->sketches );
+		hashEmpty( src->sketches );
+	}
+
+	if( src->parents != NULL )
+	{
+		mmMerge( dst->parents, src->parents, NULL, NULL );
+	}
+
+	if( dst->reach != NULL )
+	{
+		famreachFree( dst->reach );
+		dst->reach = NULL;
+	}
+	if( src->reach != NULL )
+	{
+		famreachFree( src->reach );
+		src->reach = NULL;
+	}
+
+	if( dst->log != NULL && famlogWantSnapshot( dst->log ) )
+	{
+		famcollSnapshot( dst );
+	}
+}
+
+
+/*
+ * famcoll f = famcollMergeAll( shards, n, nthreads );
+ *	Merge n independently built famcolls shards[0..n-1] into one,
+ *	which is returned (it is shards[0]; the others are freed), using
+ *	nthreads threads.  The merging is a tree reduction: in each round,
+ *	shard i absorbs shard i+stride for every i that's a multiple of
+ *	2*stride, these merges are shared out among the threads, and the
+ *	stride doubles for the next round, so after about log2(n) rounds
+ *	everything has been merged into shards[0].
+ */
+typedef struct
+{
+	famcoll * shards;
+	int	  n;
+	int	  stride;	/* merge shards[i] and shards[i+stride].. */
+	int	  first;	/* for i = first, first+step.. */
+	int	  step;
+} mergejob;
+
+static void *mergejob_thread( void *arg )
+{
+	mergejob *j = (mergejob *)arg;
+	int i;
+	for( i = j->first; i + j->stride < j->n; i += j->step )
+	{
+		famcollMerge( j->shards[i], j->shards[i + j->stride] );
+		famcollFree( j->shards[i + j->stride] );
+	}
+	return NULL;
+}
+
+famcoll famcollMergeAll( famcoll *shards, int n, int nthreads )
+{
+	assert( n > 0 && nthreads > 0 );
+	mergejob *job = (mergejob *) malloc( nthreads * sizeof(mergejob) );
+	pthread_t *tid = (pthread_t *) malloc( nthreads * sizeof(pthread_t) );
+	assert( job != NULL && tid != NULL );
+
+	int stride;
+	for( stride = 1; stride < n; stride *= 2 )
+	{
+		int nmerges = (n - stride + 2*stride - 1) / (2*stride);
+		int nt = nmerges < nthreads ? nmerges : nthreads;
+		int t;
+		for( t = 0; t < nt; t++ )
+		{
+			job[t].shards = shards;
+			job[t].n = n;
+			job[t].stride = stride;
+			job[t].first = 2 * stride * t;
+			job[t].step = 2 * stride * nt;
+			if( nt == 1 )
+			{
+				mergejob_thread( &job[t] );
+			} else
+			{
+				pthread_create( &tid[t], NULL, &mergejob_thread, &job[t] );
+			}
+		}
+		for( t = 0; nt > 1 && t < nt; t++ )
+		{
+			pthread_join( tid[t], NULL );
+		}
+	}
+	free( (void *)job );
+	free( (void *)tid );
+	return shards[0];
+}
+
+
+/*
+ * sketchadd( f, parent, child );
+ *	Add child to parent's sketches, creating them if need be.
+ *	Precondition: sketches are enabled
+ */
+static void sketchadd( famcoll f, char *parent, char *child )
+{
+	famsketch *fs = (famsketch *)hashFind( f->sketches, parent );
+	if( fs == NULL )
+	{
+		fs = (famsketch *) malloc( sizeof(famsketch) );
+		assert( fs != NULL );
+		fs->m = minhashCreate();
+		fs->h = hllCreate();
+		hashSet( f->sketches, parent, (hashvalue)fs );
+	}
+	minhashAdd( fs->m, child );
+	hllAdd( fs->h, child );
+}
+
+
 /*
  * famcollAddChild( f, parent, child );
  *	Add child to parent.
+ *	Precondition: f is not frozen
  */
 void famcollAddChild( famcoll f, char *parent, char *child )
 {
-	set s = (set)hashFind( f->f, parent );
-	if( s==NULL )	/* parent not present in f yet */
+	assert( f->frozen == NULL );	/* enforce precondition */
+	if( ! mmAdd( f->m, parent, child ) )
+	{
+		return;		/* already there: nothing else changes */
+	}
+	f->nfamilies = mmNKeys( f->m );
+
+	if( f->reach != NULL )
+	{
+		famreachAddEdge( f->reach, parent, child );
+	}
+
+	if( f->sketches != NULL )
+	{
+		sketchadd( f, parent, child );
+	}
+
+	if( f->parents != NULL )
+	{
+		mmAdd( f->parents, child, parent );
+	}
+
+	if( f->stats != NULL )
+	{
+		int i = mmKeyIndex( f->m, parent );
+		int n = mmNValuesAt( f->m, i );
+		famstatsUpdate( f->stats, i, parent, n-1, n );
+	}
+
+	if( f->log != NULL )
+	{
+		famlogAppend( f->log, parent, child );
+		if( famlogWantSnapshot( f->log ) )
+		{
+			famcollSnapshot( f );
+		}
+	}
+}
+
+
+/*
+ * famcollSnapshot( f );
+ *	Write all of persistent famcoll f's families into a new snapshot,
+ *	replacing the old snapshot and emptying the log.
+ *	Precondition: f was opened by famcollOpen()
+ */
+static void snappair_cb( char *parent, char *child, void *arg )
+{
+	famlogSnapshotPair( (famlog)arg, parent, child );
+}
+void famcollSnapshot( famcoll f )
+{
+	assert( f->log != NULL );	/* enforce precondition */
+	famlogSnapshotBegin( f->log );
+	foreachpair( f, &snappair_cb, (void *)f->log );
+	famlogSnapshotEnd( f->log );
+}
+
+
+/*
+ * famcollEnableStats( f, k );
+ *	Start maintaining statistics about f's family sizes (existing
+ *	families are counted now, and later famcollAddChild()s keep them
+ *	up to date in O(log k) each): a histogram of how many families
+ *	have each number of children, and the k biggest families.
+ *	Families are numbered in the order their parents were first
+ *	added, which is also the order foreachparent() visits them.
+ */
+typedef struct { famcoll f; int next; } statsarg;
+static void countkid_cb( setkey k, void *arg )
+{
+	(*(int *)arg)++;
+}
+static void statsfamily_cb( char *parent, void *arg )
+{
+	statsarg *sa = (statsarg *)arg;
+	int n = 0;
+	famcollForeachChild( sa->f, parent, &countkid_cb, (void *)&n );
+	famstatsUpdate( sa->f->stats, sa->next++, parent, 0, n );
+}
+void famcollEnableStats( famcoll f, int k )
+{
+	if( f->stats != NULL )
+	{
+		return;
+	}
+	f->stats = famstatsCreate( k );
+	statsarg sa; sa.f = f; sa.next = 0;
+	foreachparent( f, &statsfamily_cb, (void *)&sa );
+}
+
+
+/*
+ * famcollstats *st = famcollStats( f );
+ *	Return the current family size statistics, without scanning the
+ *	families.  The caller should famcollStatsFree() them.
+ *	Precondition: statistics are enabled
+ */
+famcollstats *famcollStats( famcoll f )
+{
+	assert( f->stats != NULL );	/* enforce precondition */
+	return famstatsGet( f->stats );
+}
+
+
+/*
+ * famcollStatsFree( st );
+ *	Free statistics st.
+ */
+void famcollStatsFree( famcollstats *st )
+{
+	int i;
+	for( i = 0; i < st->ntop; i++ )
 	{
-		s  = setCreate( NULL );
-		hashSet( f->f, parent, (hashvalue)s );
-		f->nfamilies++;
+		free( st->top[i].parent );
 	}
-	/* add child to the set */
-	setAdd( s, child );
+	free( (void *)st->top );
+	free( (void *)st->histogram );
+	free( (void *)st );
+}
+
+
+/*
+ * famcollSync( f );
+ *	Make every pair added to persistent famcoll f so far durable;
+ *	until then, recently added pairs may be lost in a crash (they
+ *	are synced anyway by famcollSnapshot() and famcollFree()).
+ *	Precondition: f was opened by famcollOpen()
+ */
+void famcollSync( famcoll f )
+{
+	assert( f->log != NULL );	/* enforce precondition */
+	famlogSync( f->log );
 }
 
 
@@ -115,8 +534,11 @@ void famcollAddChild( famcoll f, char *parent, char *child )
  */
 bool famcollIsChild( famcoll f, char *parent, char *child )
 {
-	set s = (set)hashFind( f->f, parent );
-	return s!=NULL && setIn( s, child );
+	if( f->frozen != NULL )
+	{
+		return famfrozenIsChild( f->frozen, parent, child );
+	}
+	return mmHas( f->m, parent, child );
 }
 
 
@@ -124,26 +546,289 @@ bool famcollIsChild( famcoll f, char *parent, char *child )
  * famcollDump( out, f );
  *	display family collection f to out.
  */
+static void printchild_cb( setkey child, void *arg )
+{
+	fprintf( (FILE *)arg, "%s,", child );
+}
+static void printfamily_cb( char *parent, void *arg )
+{
+	famcoll f = ((famcoll *)arg)[0];
+	FILE *out = ((FILE **)arg)[1];
+	fprintf( out, "%s: ", parent );
+	famcollForeachChild( f, parent, &printchild_cb, (void *)out );
+	fprintf( out, "\n" );
+}
 void famcollDump( FILE *out, famcoll f )
 {
-	hashDump( out, f->f );
+	void *arg[2] = { f, out };
+	fputc( '\n', out );
+	foreachparent( f, &printfamily_cb, (void *)arg );
+	fputc( '\n', out );
 	fprintf( out, "There are %d families\n", f->nfamilies );
 }
 
 
+/*
+ * famcollDumpSorted( out, f, nthreads );
+ *	display family collection f to out, like famcollDump() but with
+ *	the parents, and each parent's children, in sorted order, and
+ *	no trailing commas.  The parents are radix sorted once, then
+ *	formatted a batch at a time: nthreads threads each look up,
+ *	sort the children of, and format a slice of the batch into their
+ *	own large buffer, and the buffers are then written out in order
+ *	with a single write() each.
+ */
+#define	DUMPBATCH	65536		/* families per batch */
+
+typedef struct			/* a growable output buffer */
+{
+	char *s;
+	int   len;
+	int   cap;
+} outbuf;
+
+typedef struct			/* a growable array of strings */
+{
+	char **a;
+	int    n;
+	int    cap;
+} strarray;
+
+typedef struct			/* what each dump thread needs */
+{
+	famcoll	f;
+	char **	parent;		/* our slice of the sorted parents */
+	int	nparents;
+	outbuf	out;		/* where we format them */
+	strarray kids;		/* workspace for one family's children */
+} dumpslice;
+
+static void outappend( outbuf *b, char *s, int len )
+{
+	if( b->len + len > b->cap )
+	{
+		b->cap = (b->len + len) * 2;
+		b->s = (char *) realloc( b->s, b->cap );
+		assert( b->s != NULL );
+	}
+	memcpy( b->s + b->len, s, len );
+	b->len += len;
+}
+
+static void addstr_cb( setkey k, void *arg )
+{
+	strarray *sa = (strarray *)arg;
+	if( sa->n == sa->cap )
+	{
+		sa->cap = sa->cap == 0 ? 64 : sa->cap * 2;
+		sa->a = (char **) realloc( sa->a, sa->cap * sizeof(char *) );
+		assert( sa->a != NULL );
+	}
+	sa->a[sa->n++] = k;
+}
+
+static void addparent_cb( char *parent, void *arg )
+{
+	char ***pp = (char ***)arg;
+	*(*pp)++ = parent;
+}
+
+static void *dumpslice_thread( void *arg )
+{
+	dumpslice *ds = (dumpslice *)arg;
+	int i;
+	for( i = 0; i < ds->nparents; i++ )
+	{
+		char *parent = ds->parent[i];
+		outappend( &ds->out, parent, strlen(parent) );
+		outappend( &ds->out, ": ", 2 );
+		ds->kids.n = 0;
+		famcollForeachChild( ds->f, parent, &addstr_cb,
+				     (void *)&ds->kids );
+		strSort( ds->kids.a, ds->kids.n );
+		int k;
+		for( k = 0; k < ds->kids.n; k++ )
+		{
+			if( k > 0 )
+			{
+				outappend( &ds->out, ",", 1 );
+			}
+			outappend( &ds->out, ds->kids.a[k], strlen(ds->kids.a[k]) );
+		}
+		outappend( &ds->out, "\n", 1 );
+	}
+	return NULL;
+}
+
+static void writeall( int fd, char *s, int len )
+{
+	while( len > 0 )
+	{
+		ssize_t n = write( fd, s, len );
+		if( n < 0 )
+		{
+			perror( "famcollDumpSorted: write" );
+			exit(1);
+		}
+		s += n;
+		len -= n;
+	}
+}
+
+void famcollDumpSorted( FILE *out, famcoll f, int nthreads )
+{
+	assert( nthreads > 0 );
+	int n = f->nfamilies;
+
+	char **parents = (char **) malloc( (n+1) * sizeof(char *) );
+	assert( parents != NULL );
+	char **pp = parents;
+	foreachparent( f, &addparent_cb, (void *)&pp );
+	strSort( parents, n );
+
+	dumpslice *ds = (dumpslice *) calloc( nthreads, sizeof(dumpslice) );
+	pthread_t *tid = (pthread_t *) malloc( nthreads * sizeof(pthread_t) );
+	assert( ds != NULL && tid != NULL );
+
+	fflush( out );
+	int fd = fileno( out );
+	writeall( fd, "\n", 1 );
+	int b;
+	for( b = 0; b < n; b += DUMPBATCH )
+	{
+		int nb = n-b < DUMPBATCH ? n-b : DUMPBATCH;
+		int t;
+		for( t = 0; t < nthreads; t++ )
+		{
+			int lo = b + nb * t / nthreads;
+			int hi = b + nb * (t+1) / nthreads;
+			ds[t].f = f;
+			ds[t].parent = parents + lo;
+			ds[t].nparents = hi - lo;
+			ds[t].out.len = 0;
+			if( nthreads == 1 )
+			{
+				dumpslice_thread( &ds[t] );
+			} else
+			{
+				pthread_create( &tid[t], NULL, &dumpslice_thread, &ds[t] );
+			}
+		}
+		for( t = 0; t < nthreads; t++ )
+		{
+			if( nthreads > 1 )
+			{
+				pthread_join( tid[t], NULL );
+			}
+			writeall( fd, ds[t].out.s, ds[t].out.len );
+		}
+	}
+	fprintf( out, "\nThere are %d families\n", n );
+
+	int i;
+	for( i = 0; i < nthreads; i++ )
+	{
+		free( (void *)ds[i].out.s );
+		free( (void *)ds[i].kids.a );
+	}
+	free( (void *)ds );
+	free( (void *)tid );
+	free( (void *)parents );
+}
+
+
+/*
+ * set s = scratch( sp );
+ *	Return the scratch set *sp, emptied, creating it if need be.
+ */
+static set scratch( set *sp )
+{
+	if( *sp == NULL )
+	{
+		*sp = setCreate( NULL );
+	} else
+	{
+		setEmpty( *sp );
+	}
+	return *sp;
+}
+
+
 /*
  * set s = famcollChildren( f, parent );
- *	Retrieve parent's set of children, nb: they are not cloned
+ *	Retrieve parent's set of children, nb: they are not cloned: f
+ *	owns the set, so don't modify or free it.  It is f's one scratch
+ *	set, refilled by each call, so it is only valid until the next
+ *	call of famcollChildren() or change to f; prefer
+ *	famcollForeachChild() unless a real set is needed.
  *	Precondition: parent exists in f
  */
 set famcollChildren( famcoll f, char *parent )
 {
-	set s = (set)hashFind( f->f, parent );
-	assert( s!=NULL );	/* enforce precondition */
+	set s = scratch( &f->kids );
+	bool found = famcollForeachChild( f, parent, &viewadd_cb, (void *)s );
+	assert( found );	/* enforce precondition */
 	return s;
 }
 
 
+/*
+ * famcollEnableParents( f );
+ *	Start maintaining a reverse index from each child to the set of
+ *	their parents (existing families are indexed now, and later
+ *	famcollAddChild()s keep it up to date), for famcollParents().
+ */
+static void indexpair_cb( char *parent, char *child, void *arg )
+{
+	mmAdd( (multimap)arg, child, parent );
+}
+void famcollEnableParents( famcoll f )
+{
+	if( f->parents != NULL )
+	{
+		return;
+	}
+	f->parents = mmCreate();
+	foreachpair( f, &indexpair_cb, (void *)f->parents );
+}
+
+
+/*
+ * set s = famcollParents( f, child );
+ *	Retrieve child's set of parents, or NULL if child has no parents
+ *	in f; nb: like famcollChildren(), f owns the set, which is only
+ *	valid until the next call of famcollParents() or change to f.
+ *	Precondition: the reverse index is enabled
+ */
+set famcollParents( famcoll f, char *child )
+{
+	assert( f->parents != NULL );	/* enforce precondition */
+	if( ! mmIsKey( f->parents, child ) )
+	{
+		return NULL;
+	}
+	set s = scratch( &f->parentset );
+	mmForeachValue( f->parents, child, &viewadd_cb, (void *)s );
+	return s;
+}
+
+
+/*
+ * bool found = famcollForeachParent( f, child, cb, extra );
+ *	If child has any parents in f, call cb( parent, extra ) for each
+ *	of them (in the order they were added), straight from the reverse
+ *	index without building a set, and return true; otherwise return
+ *	false.
+ *	Precondition: the reverse index is enabled
+ */
+bool famcollForeachParent( famcoll f, char *child, setforeachcb cb, void *extra )
+{
+	assert( f->parents != NULL );	/* enforce precondition */
+	// the func ptr type cast is safe: a setkey is a char *
+	return mmForeachValue( f->parents, child, (mmvaluecb)cb, extra );
+}
+
+
 /*
  * int n = famcollNFamilies( f );
  *	how many families (parents with kids) does family collection f contain?
@@ -158,11 +843,423 @@ int famcollNFamilies( famcoll f )
  * famcollForeach( f, cb, extra );
  *	foreach (P,set of kids) entry, call the given callback cb
  *	with parent P, the set of kids, and the given extra value.
+ *	Each set of kids is built just for the callback, and freed after
+ *	it, so prefer famcollForeachChild() where possible.
  */
+typedef struct { famcoll f; famcollforeachcb cb; void *extra; } viewarg;
+static void viewfamily_cb( char *parent, void *arg )
+{
+	viewarg *va = (viewarg *)arg;
+	set kids = setCreate( NULL );
+	famcollForeachChild( va->f, parent, &viewadd_cb, (void *)kids );
+	(*va->cb)( parent, kids, va->extra );
+	setFree( kids );
+}
 void famcollForeach( famcoll f, famcollforeachcb cb, void *extra )
 {
-	// the func ptr type cast is safe, the only difference is that
-	// famcollforeachcb's 2nd arg is a set, whereas hashforeachcb's
-	// 2nd argument is a void *.  I'm sure it'll be great:-)
-	hashForeach( f->f, (hashforeachcb)cb, extra );
+	viewarg va; va.f = f; va.cb = cb; va.extra = extra;
+	foreachparent( f, &viewfamily_cb, (void *)&va );
+}
+
+
+/*
+ * bool found = famcollForeachChild( f, parent, cb, extra );
+ *	If parent has a family in f, call cb( child, extra ) for each
+ *	of their children (in sorted order if f is frozen, else in the
+ *	order they were added) and return true; otherwise return false.
+ */
+bool famcollForeachChild( famcoll f, char *parent, setforeachcb cb, void *extra )
+{
+	if( f->frozen != NULL )
+	{
+		return famfrozenForeachChild( f->frozen, parent, cb, extra );
+	}
+	// the func ptr type cast is safe: a setkey is a char *
+	return mmForeachValue( f->m, parent, (mmvaluecb)cb, extra );
+}
+
+
+/*
+ * famcollFreeze( f );
+ *	Convert f into its compact read-only form (see famfrozen.c):
+ *	all the names interned once in one string table, and the
+ *	families as flat sorted arrays of ids.  Afterwards f can be
+ *	queried, iterated and dumped, but no more children may be
+ *	added.  Any enabled reverse index or sketches are kept.
+ */
+void famcollFreeze( famcoll f )
+{
+	if( f->frozen != NULL )
+	{
+		return;
+	}
+	f->frozen = famfrozenBuild( f->m );
+	mmFree( f->m );
+	f->m = NULL;
+}
+
+
+/*
+ * foreachparent( f, cb, arg );
+ *	call cb( parent, arg ) for every parent in f.
+ */
+static void foreachparent( famcoll f, famfrozenparentcb cb, void *arg )
+{
+	if( f->frozen != NULL )
+	{
+		famfrozenForeachParent( f->frozen, cb, arg );
+	} else
+	{
+		mmForeachKey( f->m, cb, arg );
+	}
+}
+
+
+/*
+ * foreachpair( f, cb, arg );
+ *	call cb( parent, child, arg ) for every (parent, child) in f,
+ *	without needing a set per family.
+ */
+typedef struct { famcoll f; paircb cb; void *arg; char *parent; } pairarg;
+static void pairchild_cb( setkey child, void *arg )
+{
+	pairarg *pa = (pairarg *)arg;
+	(*pa->cb)( pa->parent, child, pa->arg );
+}
+static void pairparent_cb( char *parent, void *arg )
+{
+	pairarg *pa = (pairarg *)arg;
+	pa->parent = parent;
+	famcollForeachChild( pa->f, parent, &pairchild_cb, arg );
+}
+static void foreachpair( famcoll f, paircb cb, void *arg )
+{
+	pairarg pa; pa.f = f; pa.cb = cb; pa.arg = arg;
+	foreachparent( f, &pairparent_cb, (void *)&pa );
+}
+
+
+/*
+ * famcollEnableSketches( f );
+ *	Start maintaining a MinHash signature and a HyperLogLog counter
+ *	for every family in f (existing families are sketched now, later
+ *	famcollAddChild()s keep them up to date).  This is what the
+ *	approximate similarity and cardinality operations below use.
+ */
+static void sketchpair_cb( char *parent, char *child, void *arg )
+{
+	sketchadd( (famcoll)arg, parent, child );
+}
+void famcollEnableSketches( famcoll f )
+{
+	if( f->sketches != NULL )
+	{
+		return;
+	}
+	f->sketches = hashCreate( NULL, &freeSketch, &copySketch );
+	foreachpair( f, &sketchpair_cb, (void *)f );
+}
+
+
+/*
+ * famsketch *fs = findsketch( f, parent );
+ *	Find parent's sketches.
+ *	Precondition: sketches are enabled and parent exists in f
+ */
+static famsketch *findsketch( famcoll f, char *parent )
+{
+	assert( f->sketches != NULL );
+	famsketch *fs = (famsketch *)hashFind( f->sketches, parent );
+	assert( fs != NULL );
+	return fs;
+}
+
+
+/*
+ * double j = famcollSimilarity( f, p1, p2 );
+ *	Estimate the Jaccard similarity of p1's and p2's sets of children.
+ *	Precondition: sketches are enabled and both parents exist in f
+ */
+double famcollSimilarity( famcoll f, char *p1, char *p2 )
+{
+	return minhashJaccard( findsketch(f,p1)->m, findsketch(f,p2)->m );
+}
+
+
+/*
+ * double n = famcollUnionSize( f, p1, p2 );
+ *	Estimate how many distinct children p1 and p2 have between them.
+ *	Precondition: sketches are enabled and both parents exist in f
+ */
+double famcollUnionSize( famcoll f, char *p1, char *p2 )
+{
+	hll u = hllCopy( findsketch(f,p1)->h );
+	hllMerge( u, findsketch(f,p2)->h );
+	double n = hllEstimate( u );
+	hllFree( u );
+	return n;
+}
+
+
+/*
+ * double n = famcollDistinctChildren( f );
+ *	Estimate how many distinct children there are over all of f,
+ *	in one pass over the families' counters.
+ *	Precondition: sketches are enabled
+ */
+static void mergehll_cb( hashkey parent, hashvalue v, void *arg )
+{
+	hllMerge( (hll)arg, ((famsketch *)v)->h );
+}
+double famcollDistinctChildren( famcoll f )
+{
+	assert( f->sketches != NULL );
+	hll u = hllCreate();
+	hashForeach( f->sketches, &mergehll_cb, (void *)u );
+	double n = hllEstimate( u );
+	hllFree( u );
+	return n;
+}
+
+
+/*
+ * famcollNearDuplicates( f, threshold, cb, extra );
+ *	Find pairs of families whose children are similar, without
+ *	comparing every pair.  First, families with identical MinHash
+ *	signatures are grouped into classes (all similarity 1), so that
+ *	many copies of one family cost one class, not a quadratic number
+ *	of comparisons.  Then each class's signature is split into
+ *	LSH_BANDS bands of LSH_ROWS rows, the classes are sorted by each
+ *	band's hash, and every pair of classes in the same bucket (run of
+ *	equal hashes) is compared, unless they already collided in an
+ *	earlier band: so each candidate pair is compared exactly once,
+ *	with no record of the pairs seen.  No bucket is skipped, however
+ *	big, so no near-duplicates are lost; a bucket of k classes costs
+ *	O(k^2) time, but memory stays O(nfamilies).  For each pair of
+ *	families whose estimated similarity is >= threshold, call
+ *	cb( p1, p2, similarity, extra ) once, with p1 < p2 in strcmp order.
+ *	Precondition: sketches are enabled
+ */
+typedef struct
+{
+	char      *parent;
+	famsketch *fs;
+} nearfamily;
+
+typedef struct { nearfamily *fam; int n; } nearfamarg;
+
+typedef struct
+{
+	uint64_t h;		/* hash of one band, or of the whole signature */
+	int      i;		/* index of the family, or of its class */
+} bandentry;
+
+static void collect_cb( hashkey parent, hashvalue v, void *arg )
+{
+	nearfamarg *na = (nearfamarg *)arg;
+	na->fam[na->n].parent = parent;
+	na->fam[na->n].fs = (famsketch *)v;
+	na->n++;
+}
+
+static int bandcmp( const void *a, const void *b )
+{
+	const bandentry *x = (const bandentry *)a;
+	const bandentry *y = (const bandentry *)b;
+	if( x->h != y->h )
+	{
+		return x->h < y->h ? -1 : 1;
+	}
+	return x->i - y->i;
+}
+
+static void reportpair( nearfamily *x, nearfamily *y, double j,
+	famcollpaircb cb, void *extra )
+{
+	if( strcmp( x->parent, y->parent ) < 0 )
+	{
+		(*cb)( x->parent, y->parent, j, extra );
+	} else
+	{
+		(*cb)( y->parent, x->parent, j, extra );
+	}
+}
+
+void famcollNearDuplicates( famcoll f, double threshold,
+	famcollpaircb cb, void *extra )
+{
+	assert( f->sketches != NULL );
+	assert( LSH_BANDS * LSH_ROWS <= MINHASH_K );
+
+	nearfamarg na;
+	na.fam = (nearfamily *) malloc( (f->nfamilies+1) * sizeof(nearfamily) );
+	assert( na.fam != NULL );
+	na.n = 0;
+	hashForeach( f->sketches, &collect_cb, (void *)&na );
+	int n = na.n;
+
+	bandentry *e = (bandentry *) malloc( (n+1) * sizeof(bandentry) );
+	int *cstart = (int *) malloc( (n+1) * sizeof(int) );
+	int *order = (int *) malloc( (n+1) * sizeof(int) );
+	assert( e != NULL && cstart != NULL && order != NULL );
+
+	/* group the families with identical signatures into classes:
+	 * class c is families order[cstart[c]..cstart[c+1]-1]
+	 */
+	int i;
+	for( i = 0; i < n; i++ )
+	{
+		e[i].h = minhashBandHash( na.fam[i].fs->m, 0, MINHASH_K );
+		e[i].i = i;
+	}
+	qsort( e, n, sizeof(bandentry), &bandcmp );
+	int nclasses = 0;
+	for( i = 0; i < n; i++ )
+	{
+		order[i] = e[i].i;
+		if( i == 0 || e[i].h != e[i-1].h ||
+		    minhashJaccard( na.fam[order[cstart[nclasses-1]]].fs->m,
+				    na.fam[order[i]].fs->m ) < 1.0 )
+		{
+			cstart[nclasses++] = i;
+		}
+	}
+	cstart[nclasses] = n;
+
+	int c;
+	for( c = 0; c < nclasses && threshold <= 1.0; c++ )
+	{
+		int x, y;
+		for( x = cstart[c]; x < cstart[c+1]; x++ )
+		{
+			for( y = x+1; y < cstart[c+1]; y++ )
+			{
+				reportpair( &na.fam[order[x]], &na.fam[order[y]],
+					    1.0, cb, extra );
+			}
+		}
+	}
+
+	/* every class's band hashes: bh[c*LSH_BANDS+band] */
+	uint64_t *bh = (uint64_t *) malloc( (nclasses+1) * LSH_BANDS * sizeof(uint64_t) );
+	assert( bh != NULL );
+	for( c = 0; c < nclasses; c++ )
+	{
+		int band;
+		for( band = 0; band < LSH_BANDS; band++ )
+		{
+			bh[c*LSH_BANDS+band] = minhashBandHash(
+				na.fam[order[cstart[c]]].fs->m, band, LSH_ROWS );
+		}
+	}
+
+	int band;
+	for( band = 0; band < LSH_BANDS; band++ )
+	{
+		for( c = 0; c < nclasses; c++ )
+		{
+			e[c].h = bh[c*LSH_BANDS+band];
+			e[c].i = c;
+		}
+		qsort( e, nclasses, sizeof(bandentry), &bandcmp );
+
+		/* each run of equal band hashes is one LSH bucket */
+		int start;
+		for( start = 0; start < nclasses; start = i )
+		{
+			for( i = start+1; i < nclasses && e[i].h == e[start].h; i++ );
+			int x, y;
+			for( x = start; x < i; x++ )
+			{
+				uint64_t *hx = bh + (size_t)e[x].i * LSH_BANDS;
+				for( y = x+1; y < i; y++ )
+				{
+					uint64_t *hy = bh + (size_t)e[y].i * LSH_BANDS;
+					int b;
+					for( b = 0; b < band && hx[b] != hy[b]; b++ );
+					if( b < band )
+					{
+						continue;	/* compared in band b */
+					}
+					int c1 = e[x].i;
+					int c2 = e[y].i;
+					double j = minhashJaccard(
+						na.fam[order[cstart[c1]]].fs->m,
+						na.fam[order[cstart[c2]]].fs->m );
+					if( j < threshold )
+					{
+						continue;
+					}
+					int p, q;
+					for( p = cstart[c1]; p < cstart[c1+1]; p++ )
+					{
+						for( q = cstart[c2]; q < cstart[c2+1]; q++ )
+						{
+							reportpair( &na.fam[order[p]],
+								    &na.fam[order[q]],
+								    j, cb, extra );
+						}
+					}
+				}
+			}
+		}
+	}
+
+	free( (void *)bh );
+	free( (void *)order );
+	free( (void *)cstart );
+	free( (void *)e );
+	free( (void *)na.fam );
+}
+
+
+/*
+ * famreach r = reachability( f );
+ *	Return f's reachability graph, building it from f's families
+ *	the first time; famcollAddChild() keeps it up to date after that.
+ */
+static void addedge_cb( char *parent, char *child, void *arg )
+{
+	famreachAddEdge( (famreach)arg, parent, child );
+}
+static famreach reachability( famcoll f )
+{
+	if( f->reach == NULL )
+	{
+		f->reach = famreachCreate();
+		foreachpair( f, &addedge_cb, (void *)f->reach );
+	}
+	return f->reach;
+}
+
+
+/*
+ * bool isdesc = famcollIsDescendant( f, ancestor, descendant );
+ *	is descendant a child, grandchild, great-grandchild.. of ancestor?
+ */
+bool famcollIsDescendant( famcoll f, char *ancestor, char *descendant )
+{
+	return famreachIsDescendant( reachability(f), ancestor, descendant );
+}
+
+
+/*
+ * set s = famcollDescendants( f, person );
+ *	Return a new set of all of person's descendants in f.
+ *	The caller should setFree() it.
+ */
+set famcollDescendants( famcoll f, char *person )
+{
+	return famreachDescendants( reachability(f), person );
+}
+
+
+/*
+ * set s = famcollAncestors( f, person );
+ *	Return a new set of all of person's ancestors in f.
+ *	The caller should setFree() it.
+ */
+set famcollAncestors( famcoll f, char *person )
+{
+	return famreachAncestors( reachability(f), person );
 }
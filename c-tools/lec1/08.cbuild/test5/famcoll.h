@@ -10,8 +10,11 @@
  *	together.
  *
  *	We store this as a parent -> set(child) collection;
- *      actually, a hash from a string (the parent name) to a set of
- *	other strings (the names of the children of that parent).
+ *      actually, a multimap from a string (the parent name) to the
+ *	other strings (the names of the children of that parent), kept
+ *	as a vector of interned name ids per parent.  famcollForeachChild()
+ *	iterates over a family without building a set; famcollChildren()
+ *	and famcollForeach() build real sets only on request.
  *
  * (C) Duncan C. White, May 2017
  */
@@ -25,11 +28,65 @@ typedef struct famcoll_s *famcoll;
 /* a famcoll foreach callback is called by famcollForeach() once per family */
 typedef void (*famcollforeachcb)( char *parent, set kids, void *extra );
 
+/* a famcoll pair callback is called by famcollNearDuplicates() once per
+ * pair of similar families (p1 < p2 in strcmp order)
+ */
+typedef void (*famcollpaircb)( char *p1, char *p2, double similarity, void *extra );
+
+/* famcollStats() returns a snapshot of the family size statistics */
+typedef struct
+{
+	char *	parent;
+	int	nchildren;
+} famcollfamily;
+
+typedef struct
+{
+	int	nfamilies;
+	long	npairs;			/* total (parent, child) pairs */
+	int	maxchildren;		/* size of the biggest family */
+	int *	histogram;		/* [0..maxchildren]: how many families */
+					/* have that many children */
+	int	ntop;
+	famcollfamily *top;		/* the (at most k) biggest families, */
+					/* biggest first */
+} famcollstats;
+
 extern famcoll famcollCreate( void );
 extern void famcollFree( famcoll f );
+extern void famcollMerge( famcoll dst, famcoll src );
+extern famcoll famcollMergeAll( famcoll * shards, int n, int nthreads );
 extern void famcollAddChild( famcoll f, char * parent, char * child );
 extern bool famcollIsChild( famcoll f, char * parent, char * child );
 extern void famcollDump( FILE * out, famcoll f );
+extern void famcollDumpSorted( FILE * out, famcoll f, int nthreads );
 extern set famcollChildren( famcoll f, char * parent );
+extern void famcollEnableParents( famcoll f );
+extern set famcollParents( famcoll f, char * child );
+extern bool famcollForeachParent( famcoll f, char * child, setforeachcb cb, void * extra );
 extern int famcollNFamilies( famcoll f );
 extern void famcollForeach( famcoll f, famcollforeachcb cb, void * extra );
+extern bool famcollForeachChild( famcoll f, char * parent, setforeachcb cb, void * extra );
+extern void famcollFreeze( famcoll f );
+
+/* persistence: an append-only log plus snapshots, in a directory */
+extern famcoll famcollOpen( char * dir );
+extern void famcollSnapshot( famcoll f );
+extern void famcollSync( famcoll f );
+
+/* statistics: incrementally maintained family size distribution */
+extern void famcollEnableStats( famcoll f, int k );
+extern famcollstats *famcollStats( famcoll f );
+extern void famcollStatsFree( famcollstats * st );
+
+/* approximate analytics, via optional per-family sketches */
+extern void famcollEnableSketches( famcoll f );
+extern double famcollSimilarity( famcoll f, char * p1, char * p2 );
+extern double famcollUnionSize( famcoll f, char * p1, char * p2 );
+extern double famcollDistinctChildren( famcoll f );
+extern void famcollNearDuplicates( famcoll f, double threshold, famcollpaircb cb, void * extra );
+
+/* reachability: multi-generation queries */
+extern bool famcollIsDescendant( famcoll f, char * ancestor, char * descendant );
+extern set famcollDescendants( famcoll f, char * person );
+extern set famcollAncestors( famcoll f, char * person );
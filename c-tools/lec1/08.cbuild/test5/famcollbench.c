@@ -0,0 +1,190 @@
+/*
+ *   famcollbench: microbenchmarks for the famcoll module.
+ *
+ *		usage: famcollbench benchmark pairsfile
+ *		benchmark is one of: addchild, ischild, dumpsorted,
+ *		freeze, mergeall.  The pairs ("parent: child" lines)
+ *		are read into memory first, untimed; then the benchmark
+ *		runs, and prints one line: the seconds it took, and how
+ *		many operations it did (pairs added, or pairs looked up).
+ *
+ *		addchild:   famcollAddChild() every pair
+ *		ischild:    then famcollIsChild() every pair
+ *		dumpsorted: then famcollDumpSorted() to /dev/null
+ *		freeze:     then famcollFreeze()
+ *		mergeall:   add the pairs to BENCHSHARDS famcolls, a
+ *			    contiguous slice each (so parents overlap),
+ *			    then famcollMergeAll() them with 1 thread
+ *
+ *	Only the part after "then" is timed.  runbench runs these.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <set.h>
+
+#include "famcoll.h"
+
+
+#define	BENCHSHARDS	8
+
+
+static double now( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+/*
+ * long n = readpairs( path, &parent, &child );
+ *	Read all of file path into memory, split it into "parent: child"
+ *	pairs in place, and set parent and child to arrays of them.
+ */
+static long readpairs( char *path, char ***parent, char ***child )
+{
+	int fd = open( path, O_RDONLY );
+	struct stat st;
+	if( fd < 0 || fstat( fd, &st ) < 0 )
+	{
+		perror( path );
+		exit(1);
+	}
+	char *buf = malloc( st.st_size + 1 );
+	assert( buf != NULL );
+	off_t got = 0;
+	ssize_t n;
+	while( got < st.st_size && (n = read( fd, buf+got, st.st_size-got )) > 0 )
+	{
+		got += n;
+	}
+	close( fd );
+	buf[got] = '\0';
+
+	long cap = 1024;
+	long np = 0;
+	*parent = (char **) malloc( cap * sizeof(char *) );
+	*child = (char **) malloc( cap * sizeof(char *) );
+	char *p = buf;
+	char *end = buf + got;
+	while( p < end )
+	{
+		char *nl = memchr( p, '\n', end-p );
+		if( nl == NULL )
+		{
+			nl = end;
+		}
+		*nl = '\0';
+		char *colon = strchr( p, ':' );
+		if( colon != NULL )
+		{
+			*colon = '\0';
+			char *c = colon + 1;
+			while( *c == ' ' )
+			{
+				c++;
+			}
+			if( np == cap )
+			{
+				cap *= 2;
+				*parent = (char **) realloc( *parent, cap * sizeof(char *) );
+				*child = (char **) realloc( *child, cap * sizeof(char *) );
+				assert( *parent != NULL && *child != NULL );
+			}
+			(*parent)[np] = p;
+			(*child)[np] = c;
+			np++;
+		}
+		p = nl + 1;
+	}
+	return np;
+}
+
+
+static famcoll build( long n, char **parent, char **child )
+{
+	famcoll f = famcollCreate();
+	long i;
+	for( i = 0; i < n; i++ )
+	{
+		famcollAddChild( f, parent[i], child[i] );
+	}
+	return f;
+}
+
+
+int main( int argc, char **argv )
+{
+	if( argc != 3 )
+	{
+		fprintf( stderr, "Usage: famcollbench benchmark pairsfile\n" );
+		exit(1);
+	}
+	char *bench = argv[1];
+	char **parent, **child;
+	long n = readpairs( argv[2], &parent, &child );
+	famcoll f = NULL;
+	long ops = n;
+	double start;
+	long i;
+
+	if( strcmp( bench, "addchild" ) == 0 )
+	{
+		start = now();
+		f = build( n, parent, child );
+	} else if( strcmp( bench, "ischild" ) == 0 )
+	{
+		f = build( n, parent, child );
+		long found = 0;
+		start = now();
+		for( i = 0; i < n; i++ )
+		{
+			found += famcollIsChild( f, parent[i], child[i] );
+		}
+		assert( found == n );
+	} else if( strcmp( bench, "dumpsorted" ) == 0 )
+	{
+		f = build( n, parent, child );
+		FILE *devnull = fopen( "/dev/null", "w" );
+		assert( devnull != NULL );
+		start = now();
+		famcollDumpSorted( devnull, f, 1 );
+		fclose( devnull );
+	} else if( strcmp( bench, "freeze" ) == 0 )
+	{
+		f = build( n, parent, child );
+		start = now();
+		famcollFreeze( f );
+	} else if( strcmp( bench, "mergeall" ) == 0 )
+	{
+		famcoll shard[BENCHSHARDS];
+		int s;
+		for( s = 0; s < BENCHSHARDS; s++ )
+		{
+			long lo = n * s / BENCHSHARDS;
+			long hi = n * (s+1) / BENCHSHARDS;
+			shard[s] = build( hi-lo, parent+lo, child+lo );
+		}
+		start = now();
+		f = famcollMergeAll( shard, BENCHSHARDS, 1 );
+	} else
+	{
+		fprintf( stderr, "famcollbench: unknown benchmark %s\n", bench );
+		exit(1);
+	}
+	double secs = now() - start;
+	printf( "%.6f %ld\n", secs, ops );
+
+	famcollFree( f );
+	return 0;
+}
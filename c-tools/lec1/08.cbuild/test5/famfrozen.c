@@ -0,0 +1,307 @@
+/*
+ * famfrozen.c: a read-only, compact form of a family collection:
+ *		compressed sparse rows of interned name ids.
+ *
+ *	Every distinct name (parent or child) is stored once, in one
+ *	contiguous string table, in sorted order, so that a name's id
+ *	is its position in sorted order and comparing ids is the same
+ *	as comparing names.  Then the families are three flat arrays:
+ *
+ *	- parent[0..nparents-1]: the parents' ids, in increasing order,
+ *	- offset[0..nparents]: parent[i]'s children are kid[offset[i]]
+ *	  up to (but not including) kid[offset[i+1]],
+ *	- kid[]: every family's child ids, each family's in increasing
+ *	  order.
+ *
+ *	Looking up a name, a parent, or a child within a family are all
+ *	binary searches, and iterating over a family scans contiguous
+ *	memory in sorted order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <set.h>
+#include <multimap.h>
+#include <strsort.h>
+
+#include "famfrozen.h"
+
+
+struct famfrozen_s
+{
+	char *	strings;	/* all the names, '\0' terminated */
+	int *	nameoff;	/* id -> offset of that name in strings */
+	int	nnames;
+	int *	parent;		/* the parents' ids, sorted */
+	int	nparents;
+	int *	offset;		/* parent[i]'s kids are kid[offset[i]..] */
+	int *	kid;		/* the children's ids */
+};
+
+
+typedef struct		/* a growable array of strings */
+{
+	char **a;
+	int    n;
+	int    cap;
+} strarray;
+
+
+static void strpush( strarray *sa, char *s )
+{
+	if( sa->n == sa->cap )
+	{
+		sa->cap = sa->cap == 0 ? 1024 : sa->cap * 2;
+		sa->a = (char **) realloc( sa->a, sa->cap * sizeof(char *) );
+		assert( sa->a != NULL );
+	}
+	sa->a[sa->n++] = s;
+}
+
+
+static void pushkid_cb( char *k, void *arg )
+{
+	strpush( (strarray *)arg, k );
+}
+
+static void pushfamily_cb( char *parent, void *arg )
+{
+	void **fa = (void **)arg;
+	strpush( (strarray *)fa[1], parent );
+	mmForeachValue( (multimap)fa[0], parent, &pushkid_cb, fa[1] );
+}
+
+static void pushparent_cb( char *parent, void *arg )
+{
+	strpush( (strarray *)arg, parent );
+}
+
+
+static char *name( famfrozen z, int id )
+{
+	return z->strings + z->nameoff[id];
+}
+
+
+/*
+ * int id = nameid( z, s );
+ *	Return the id of name s, or -1 if it's not in z.
+ */
+static int nameid( famfrozen z, char *s )
+{
+	int lo = 0;
+	int hi = z->nnames - 1;
+	while( lo <= hi )
+	{
+		int mid = lo + (hi-lo)/2;
+		int rc = strcmp( name(z, mid), s );
+		if( rc == 0 )
+		{
+			return mid;
+		}
+		if( rc < 0 )
+		{
+			lo = mid+1;
+		} else
+		{
+			hi = mid-1;
+		}
+	}
+	return -1;
+}
+
+
+/*
+ * int pos = intsearch( a, n, x );
+ *	Return the position of x in sorted a[0..n-1], or -1.
+ */
+static int intsearch( int *a, int n, int x )
+{
+	int lo = 0;
+	int hi = n - 1;
+	while( lo <= hi )
+	{
+		int mid = lo + (hi-lo)/2;
+		if( a[mid] == x )
+		{
+			return mid;
+		}
+		if( a[mid] < x )
+		{
+			lo = mid+1;
+		} else
+		{
+			hi = mid-1;
+		}
+	}
+	return -1;
+}
+
+
+/*
+ * int i = parentindex( z, parent );
+ *	Return parent's index in z->parent, or -1.
+ */
+static int parentindex( famfrozen z, char *parent )
+{
+	int id = nameid( z, parent );
+	return id < 0 ? -1 : intsearch( z->parent, z->nparents, id );
+}
+
+
+static int intcmp( const void *a, const void *b )
+{
+	int x = *(const int *)a;
+	int y = *(const int *)b;
+	return x < y ? -1 : x > y;
+}
+
+
+/*
+ * famfrozen z = famfrozenBuild( families );
+ *	Build the frozen form of a multimap from parent names to
+ *	children's names.
+ */
+typedef struct { famfrozen z; int next; } kidarg;
+static void addkid_cb( char *k, void *arg )
+{
+	kidarg *ka = (kidarg *)arg;
+	ka->z->kid[ka->next++] = nameid( ka->z, k );
+}
+
+famfrozen famfrozenBuild( multimap families )
+{
+	famfrozen z = (famfrozen) malloc( sizeof(struct famfrozen_s) );
+	assert( z != NULL );
+
+	/* every name, sorted and deduplicated, is the string table */
+	strarray all = { NULL, 0, 0 };
+	void *fa[2] = { families, &all };
+	mmForeachKey( families, &pushfamily_cb, (void *)fa );
+	strSort( all.a, all.n );
+	int i;
+	int nnames = 0;
+	size_t bytes = 0;
+	for( i = 0; i < all.n; i++ )
+	{
+		if( i == 0 || strcmp( all.a[i], all.a[nnames-1] ) != 0 )
+		{
+			all.a[nnames++] = all.a[i];
+			bytes += strlen( all.a[i] ) + 1;
+		}
+	}
+	z->nnames = nnames;
+	z->strings = (char *) malloc( bytes + 1 );
+	z->nameoff = (int *) malloc( (nnames+1) * sizeof(int) );
+	assert( z->strings != NULL && z->nameoff != NULL );
+	int off = 0;
+	for( i = 0; i < nnames; i++ )
+	{
+		z->nameoff[i] = off;
+		int len = strlen( all.a[i] ) + 1;
+		memcpy( z->strings + off, all.a[i], len );
+		off += len;
+	}
+	int npairs = all.n;	/* parents + pairs: an upper bound on pairs */
+
+	/* the parents, in sorted order */
+	all.n = 0;
+	mmForeachKey( families, &pushparent_cb, (void *)&all );
+	strSort( all.a, all.n );
+	z->nparents = all.n;
+	z->parent = (int *) malloc( (z->nparents+1) * sizeof(int) );
+	z->offset = (int *) malloc( (z->nparents+1) * sizeof(int) );
+	z->kid = (int *) malloc( (npairs+1) * sizeof(int) );
+	assert( z->parent != NULL && z->offset != NULL && z->kid != NULL );
+
+	/* and each parent's children, sorted by id */
+	kidarg ka; ka.z = z; ka.next = 0;
+	for( i = 0; i < z->nparents; i++ )
+	{
+		z->parent[i] = nameid( z, all.a[i] );
+		z->offset[i] = ka.next;
+		mmForeachValue( families, all.a[i], &addkid_cb, (void *)&ka );
+		qsort( z->kid + z->offset[i], ka.next - z->offset[i],
+		       sizeof(int), &intcmp );
+	}
+	z->offset[z->nparents] = ka.next;
+	z->kid = (int *) realloc( z->kid, (ka.next+1) * sizeof(int) );
+	assert( z->kid != NULL );
+
+	free( (void *)all.a );
+	return z;
+}
+
+
+/*
+ * famfrozenFree( z );
+ *	Free z.
+ */
+void famfrozenFree( famfrozen z )
+{
+	free( (void *)z->kid );
+	free( (void *)z->offset );
+	free( (void *)z->parent );
+	free( (void *)z->nameoff );
+	free( (void *)z->strings );
+	free( (void *)z );
+}
+
+
+/*
+ * bool ischild = famfrozenIsChild( z, parent, child );
+ *	is child a child of parent?
+ */
+bool famfrozenIsChild( famfrozen z, char *parent, char *child )
+{
+	int p = parentindex( z, parent );
+	int c = nameid( z, child );
+	if( p < 0 || c < 0 )
+	{
+		return false;
+	}
+	int lo = z->offset[p];
+	return intsearch( z->kid + lo, z->offset[p+1] - lo, c ) >= 0;
+}
+
+
+/*
+ * bool found = famfrozenForeachChild( z, parent, cb, arg );
+ *	If parent has a family in z, call cb( child, arg ) for each of
+ *	their children, in sorted order, and return true; otherwise
+ *	return false.
+ */
+bool famfrozenForeachChild( famfrozen z, char *parent, setforeachcb cb, void *arg )
+{
+	int p = parentindex( z, parent );
+	if( p < 0 )
+	{
+		return false;
+	}
+	int i;
+	for( i = z->offset[p]; i < z->offset[p+1]; i++ )
+	{
+		(*cb)( name(z, z->kid[i]), arg );
+	}
+	return true;
+}
+
+
+/*
+ * famfrozenForeachParent( z, cb, arg );
+ *	Call cb( parent, arg ) for each parent in z, in sorted order.
+ */
+void famfrozenForeachParent( famfrozen z, famfrozenparentcb cb, void *arg )
+{
+	int i;
+	for( i = 0; i < z->nparents; i++ )
+	{
+		(*cb)( name(z, z->parent[i]), arg );
+	}
+}
+
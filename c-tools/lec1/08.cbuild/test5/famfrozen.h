@@ -0,0 +1,14 @@
+/*
+ * famfrozen.h: a read-only, compact form of a family collection:
+ *		compressed sparse rows of interned name ids.
+ */
+
+typedef struct famfrozen_s *famfrozen;
+
+typedef void (*famfrozenparentcb)( char * parent, void * arg );
+
+extern famfrozen famfrozenBuild( multimap families );
+extern void famfrozenFree( famfrozen z );
+extern bool famfrozenIsChild( famfrozen z, char * parent, char * child );
+extern bool famfrozenForeachChild( famfrozen z, char * parent, setforeachcb cb, void * arg );
+extern void famfrozenForeachParent( famfrozen z, famfrozenparentcb cb, void * arg );
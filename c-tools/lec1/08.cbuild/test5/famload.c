@@ -0,0 +1,218 @@
+/*
+ *   famload: a load generator for famserver: measure how long its
+ *	      queries take, from a client on the same host.
+ *
+ *		usage: famload socketpath nqueries < input
+ *		input is "parent: child" lines, normally the same input
+ *		the server loaded: half the queries ask about pairs from
+ *		it, the other half about a parent and some other pair's
+ *		child (usually not its child).
+ *
+ *	It runs nqueries ischild queries in each of three ways: one at
+ *	a time, waiting for each answer (reporting the mean and 50th and
+ *	99th percentile latency); PIPEDEPTH at a time, pipelined; and
+ *	BATCHSIZE at a time, in one batched request.  Then a tenth as
+ *	many children queries, and as many parents queries, one at a time
+ *	(reporting their latency percentiles too).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "linereader.h"
+#include "famclient.h"
+
+
+#define	MAXPAIRS	1000000		/* pairs of the input kept */
+#define	PIPEDEPTH	64
+#define	BATCHSIZE	256
+
+
+static double now( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static int dblcmp( const void *a, const void *b )
+{
+	double x = *(const double *)a;
+	double y = *(const double *)b;
+	return x < y ? -1 : x > y;
+}
+
+
+static void report( char *what, int n, double secs, int nyes )
+{
+	printf( "%-22s %8d queries %8.2f us/query %10.0f queries/s  (%d yes)\n",
+		what, n, secs * 1e6 / n, n / secs, nyes );
+}
+
+
+static void percentiles( double *lat, int n )
+{
+	qsort( lat, n, sizeof(double), &dblcmp );
+	printf( "%-22s p50 %.2f us, p99 %.2f us, max %.2f us\n", "",
+		lat[n/2] * 1e6, lat[n*99/100] * 1e6, lat[n-1] * 1e6 );
+}
+
+
+static void count_cb( char *name, void *arg )
+{
+	(*(int *)arg)++;
+}
+
+
+/*
+ * namesquery( fc, what, query, names, n, lat );
+ *	Time n queries (query is fcChildren or fcParents) about names[0..n-1],
+ *	one at a time, each latency going in lat[], and report them.
+ */
+typedef int (*namesfn)( famclient c, char *name, fcnamecb cb, void *arg );
+static void namesquery( famclient fc, char *what, namesfn query,
+	char **names, int n, double *lat )
+{
+	int nnames = 0;
+	int nfound = 0;
+	int i;
+	double start = now();
+	for( i = 0; i < n; i++ )
+	{
+		double t = now();
+		int rc = (*query)( fc, names[i], &count_cb, (void *)&nnames );
+		lat[i] = now() - t;
+		assert( rc >= 0 );
+		nfound += rc > 0;
+	}
+	double secs = now() - start;
+	report( what, n, secs, nfound );
+	percentiles( lat, n );
+	printf( "%-22s %.1f names per answer\n", "", (double)nnames / n );
+}
+
+
+int main( int argc, char **argv )
+{
+	if( argc != 3 )
+	{
+		fprintf( stderr, "Usage: famload socketpath nqueries < input\n" );
+		exit(1);
+	}
+	int nq = atoi( argv[2] );
+	assert( nq > 0 );
+
+	/* read (up to MAXPAIRS of) the input pairs */
+	char **parent = (char **) malloc( MAXPAIRS * sizeof(char *) );
+	char **child = (char **) malloc( MAXPAIRS * sizeof(char *) );
+	assert( parent != NULL && child != NULL );
+	int npairs = 0;
+	char *line;
+	int len;
+	linereader r = lrCreate( 0 );
+	while( npairs < MAXPAIRS && lrNext( r, &line, &len ) )
+	{
+		char *p = strtok( line, ": " );
+		char *c = strtok( NULL, ": " );
+		if( p != NULL && c != NULL )
+		{
+			parent[npairs] = strdup( p );
+			child[npairs] = strdup( c );
+			npairs++;
+		}
+	}
+	if( lrError( r ) != 0 )
+	{
+		fprintf( stderr, "famload: read error: %s\n", strerror( lrError( r ) ) );
+		exit(1);
+	}
+	lrFree( r );
+	if( npairs == 0 )
+	{
+		fprintf( stderr, "famload: no pairs in input\n" );
+		exit(1);
+	}
+
+	/* the queries */
+	char **qp = (char **) malloc( nq * sizeof(char *) );
+	char **qc = (char **) malloc( nq * sizeof(char *) );
+	bool *result = (bool *) malloc( nq * sizeof(bool) );
+	double *lat = (double *) malloc( nq * sizeof(double) );
+	assert( qp != NULL && qc != NULL && result != NULL && lat != NULL );
+	srand( 42 );
+	int i;
+	for( i = 0; i < nq; i++ )
+	{
+		int a = rand() % npairs;
+		int b = i % 2 == 0 ? a : rand() % npairs;
+		qp[i] = parent[a];
+		qc[i] = child[b];
+	}
+
+	famclient fc = fcConnect( argv[1] );
+	if( fc == NULL )
+	{
+		perror( argv[1] );
+		exit(1);
+	}
+	printf( "server has %d families\n", fcNFamilies( fc ) );
+
+	/* one at a time */
+	int nyes = 0;
+	double start = now();
+	for( i = 0; i < nq; i++ )
+	{
+		double t = now();
+		int rc = fcIsChild( fc, qp[i], qc[i] );
+		lat[i] = now() - t;
+		assert( rc >= 0 );
+		nyes += rc;
+	}
+	double secs = now() - start;
+	report( "ischild, one at a time", nq, secs, nyes );
+	percentiles( lat, nq );
+
+	/* pipelined */
+	start = now();
+	for( i = 0; i < nq; i += PIPEDEPTH )
+	{
+		int n = nq - i < PIPEDEPTH ? nq - i : PIPEDEPTH;
+		int rc = fcPipelineIsChild( fc, n, qp+i, qc+i, result+i );
+		assert( rc == 0 );
+	}
+	secs = now() - start;
+	for( nyes = i = 0; i < nq; i++ )
+	{
+		nyes += result[i];
+	}
+	report( "ischild, pipelined", nq, secs, nyes );
+
+	/* batched */
+	start = now();
+	for( i = 0; i < nq; i += BATCHSIZE )
+	{
+		int n = nq - i < BATCHSIZE ? nq - i : BATCHSIZE;
+		int rc = fcIsChildBatch( fc, n, qp+i, qc+i, result+i );
+		assert( rc == 0 );
+	}
+	secs = now() - start;
+	for( nyes = i = 0; i < nq; i++ )
+	{
+		nyes += result[i];
+	}
+	report( "ischild, batched", nq, secs, nyes );
+
+	/* children and parents */
+	int nc = nq / 10 > 0 ? nq / 10 : 1;
+	namesquery( fc, "children", &fcChildren, qp, nc, lat );
+	namesquery( fc, "parents", &fcParents, qc, nc, lat );
+
+	fcClose( fc );
+	return 0;
+}
@@ -0,0 +1,458 @@
+/*
+ * famlog.c: persistence for a family collection: an append-only log
+ *	     of added (parent, child) pairs plus a compact snapshot,
+ *	     both kept in one directory.
+ *
+ *	DIR/snapshot holds every pair as of the last snapshot, grouped
+ *	into families: the magic string SNAPMAGIC, then a sequence of
+ *	records, each a 32-bit word (len << 1 | isparent) followed by len
+ *	bytes of name.  A parent record starts a new family, and each
+ *	child record adds a child to the current one.
+ *
+ *	DIR/log holds every pair added since then, each as two 32-bit
+ *	lengths followed by the parent's and child's bytes.  Appends are
+ *	buffered and written with one write() per LOGBUF bytes; they are
+ *	durable once famlogSync() (or famlogSnapshotEnd() or famlogClose())
+ *	returns.  All words are in host byte order.
+ *
+ *	famlogOpen() reads the snapshot and then the log, handing every
+ *	pair to a callback.  A log record cut short by a crash is dropped,
+ *	and the log is truncated back to the last whole record.
+ *
+ *	A new snapshot is written to DIR/snapshot.tmp, fsync()ed, and
+ *	renamed over DIR/snapshot, and only then is the log emptied (if
+ *	writing it failed, it's thrown away and the log kept).  A
+ *	crash in between leaves a new snapshot and an old log, and
+ *	replaying that log is harmless: adding a pair twice is the same
+ *	as adding it once.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "famlog.h"
+
+
+#define	SNAPMAGIC	"FAMSNAP1"
+#define	SNAPMAGICLEN	8
+#define	LOGBUF		(64*1024)	/* bytes of appends buffered */
+#define	MINSNAPLOG	(1024*1024)	/* smallest log worth snapshotting */
+
+
+struct famlog_s
+{
+	char *	 dir;
+	int	 logfd;		/* DIR/log, open for appending */
+	off_t	 logbytes;	/* size of the log, including buf */
+	off_t	 snapbytes;	/* size of the last snapshot */
+	char	 buf[LOGBUF];	/* appends not yet written */
+	int	 buflen;
+	FILE *	 snap;		/* the snapshot being written, or NULL */
+	char *	 lastparent;	/* the last parent written to snap */
+	char *	 name[2];	/* takename()'s buffers */
+	int	 namecap[2];
+};
+
+
+static char *pathof( famlog l, char *name )
+{
+	char *path = malloc( strlen(l->dir) + strlen(name) + 2 );
+	assert( path != NULL );
+	sprintf( path, "%s/%s", l->dir, name );
+	return path;
+}
+
+
+static void fail( char *what, char *path )
+{
+	fprintf( stderr, "famlog: " );
+	perror( path != NULL ? path : what );
+	exit(1);
+}
+
+
+/*
+ * char *buf = slurp( path, &len );
+ *	Read the whole of file path into a malloc()d buffer, setting len,
+ *	or return NULL (with len 0) if there's no such file.
+ */
+static char *slurp( char *path, off_t *len )
+{
+	*len = 0;
+	int fd = open( path, O_RDONLY );
+	if( fd < 0 )
+	{
+		return NULL;
+	}
+	struct stat st;
+	if( fstat( fd, &st ) < 0 )
+	{
+		fail( "fstat", path );
+	}
+	char *buf = malloc( st.st_size + 1 );
+	assert( buf != NULL );
+	off_t got = 0;
+	while( got < st.st_size )
+	{
+		ssize_t n = read( fd, buf + got, st.st_size - got );
+		if( n < 0 )
+		{
+			fail( "read", path );
+		}
+		if( n == 0 )
+		{
+			break;
+		}
+		got += n;
+	}
+	close( fd );
+	*len = got;
+	return buf;
+}
+
+
+/*
+ * char *s = takename( l, buf, &pos, namelen, which );
+ *	Copy the namelen bytes at buf[pos] into a NUL-terminated name,
+ *	advancing pos.  The name is in l's buffer number which (0 or 1),
+ *	overwritten by the next call with the same which.
+ */
+static char *takename( famlog l, char *buf, off_t *pos, int namelen, int which )
+{
+	if( namelen + 1 > l->namecap[which] )
+	{
+		l->namecap[which] = (namelen + 1) * 2;
+		l->name[which] = realloc( l->name[which], l->namecap[which] );
+		assert( l->name[which] != NULL );
+	}
+	memcpy( l->name[which], buf + *pos, namelen );
+	l->name[which][namelen] = '\0';
+	*pos += namelen;
+	return l->name[which];
+}
+
+
+/*
+ * readsnapshot( l, cb, arg );
+ *	Call cb( parent, child, arg ) for every pair in l's snapshot.
+ */
+static void readsnapshot( famlog l, famlogpaircb cb, void *arg )
+{
+	char *path = pathof( l, "snapshot" );
+	off_t len;
+	char *buf = slurp( path, &len );
+	l->snapbytes = len;
+	if( buf == NULL )
+	{
+		free( path );
+		return;
+	}
+	if( len < SNAPMAGICLEN || memcmp( buf, SNAPMAGIC, SNAPMAGICLEN ) != 0 )
+	{
+		fprintf( stderr, "famlog: %s is not a snapshot\n", path );
+		exit(1);
+	}
+	off_t pos = SNAPMAGICLEN;
+	char *parent = NULL;
+	while( pos + 4 <= len )
+	{
+		uint32_t word;
+		memcpy( &word, buf + pos, 4 );
+		pos += 4;
+		int namelen = word >> 1;
+		if( pos + namelen > len || (parent == NULL && !(word & 1)) )
+		{
+			break;
+		}
+		if( word & 1 )
+		{
+			parent = takename( l, buf, &pos, namelen, 0 );
+		} else
+		{
+			(*cb)( parent, takename( l, buf, &pos, namelen, 1 ), arg );
+		}
+	}
+	if( pos != len )
+	{
+		fprintf( stderr, "famlog: %s is corrupt\n", path );
+		exit(1);
+	}
+	free( buf );
+	free( path );
+}
+
+
+/*
+ * off_t good = readlog( l, cb, arg );
+ *	Call cb( parent, child, arg ) for every whole record in l's log,
+ *	and return the length of the log up to the end of the last one.
+ */
+static off_t readlog( famlog l, famlogpaircb cb, void *arg )
+{
+	char *path = pathof( l, "log" );
+	off_t len;
+	char *buf = slurp( path, &len );
+	free( path );
+	off_t pos = 0;
+	while( pos + 8 <= len )
+	{
+		uint32_t plen, clen;
+		memcpy( &plen, buf + pos, 4 );
+		memcpy( &clen, buf + pos + 4, 4 );
+		if( pos + 8 + (off_t)plen + clen > len )
+		{
+			break;		/* torn by a crash mid-append */
+		}
+		pos += 8;
+		char *parent = takename( l, buf, &pos, plen, 0 );
+		char *child = takename( l, buf, &pos, clen, 1 );
+		(*cb)( parent, child, arg );
+	}
+	free( buf );
+	return pos;
+}
+
+
+/*
+ * famlog l = famlogOpen( dir, cb, arg );
+ *	Open the log and snapshot in directory dir (which must exist),
+ *	calling cb( parent, child, arg ) for every pair in the snapshot
+ *	and then every pair in the log, ready to append more pairs.
+ *	The strings passed to cb are only valid during the call.
+ */
+famlog famlogOpen( char *dir, famlogpaircb cb, void *arg )
+{
+	famlog l = (famlog) malloc( sizeof(struct famlog_s) );
+	assert( l != NULL );
+	l->dir = strdup( dir );
+	l->buflen = 0;
+	l->snap = NULL;
+	l->lastparent = NULL;
+	l->name[0] = l->name[1] = NULL;
+	l->namecap[0] = l->namecap[1] = 0;
+
+	readsnapshot( l, cb, arg );
+	off_t good = readlog( l, cb, arg );
+
+	char *path = pathof( l, "log" );
+	l->logfd = open( path, O_WRONLY|O_CREAT|O_APPEND, 0644 );
+	if( l->logfd < 0 || ftruncate( l->logfd, good ) < 0 )
+	{
+		fail( "open", path );
+	}
+	free( path );
+	l->logbytes = good;
+	return l;
+}
+
+
+/*
+ * writeall( fd, s, len );
+ *	write() all of s[0..len-1] to fd, or die.
+ */
+static void writeall( int fd, char *s, int len )
+{
+	while( len > 0 )
+	{
+		ssize_t n = write( fd, s, len );
+		if( n < 0 )
+		{
+			fail( "write", "log" );
+		}
+		s += n;
+		len -= n;
+	}
+}
+
+
+static void flush( famlog l )
+{
+	writeall( l->logfd, l->buf, l->buflen );
+	l->buflen = 0;
+}
+
+
+/*
+ * famlogAppend( l, parent, child );
+ *	Append the pair (parent, child) to l's log.
+ */
+void famlogAppend( famlog l, char *parent, char *child )
+{
+	uint32_t plen = strlen( parent );
+	uint32_t clen = strlen( child );
+	int len = 8 + plen + clen;
+	if( l->buflen + len > LOGBUF )
+	{
+		flush( l );
+	}
+	if( len > LOGBUF )		/* too big to buffer */
+	{
+		char *rec = malloc( len );
+		assert( rec != NULL );
+		memcpy( rec, &plen, 4 );
+		memcpy( rec + 4, &clen, 4 );
+		memcpy( rec + 8, parent, plen );
+		memcpy( rec + 8 + plen, child, clen );
+		writeall( l->logfd, rec, len );
+		free( rec );
+	} else
+	{
+		char *p = l->buf + l->buflen;
+		memcpy( p, &plen, 4 );
+		memcpy( p + 4, &clen, 4 );
+		memcpy( p + 8, parent, plen );
+		memcpy( p + 8 + plen, child, clen );
+		l->buflen += len;
+	}
+	l->logbytes += len;
+}
+
+
+/*
+ * famlogSync( l );
+ *	Make every pair appended so far durable.
+ */
+void famlogSync( famlog l )
+{
+	flush( l );
+	if( fsync( l->logfd ) < 0 )
+	{
+		fail( "fsync", "log" );
+	}
+}
+
+
+/*
+ * bool want = famlogWantSnapshot( l );
+ *	Has l's log grown big enough to be worth folding into a new
+ *	snapshot?  That's when it's at least MINSNAPLOG bytes and as
+ *	big as the last snapshot, so the cost of writing snapshots is
+ *	at most a constant per appended byte.
+ */
+bool famlogWantSnapshot( famlog l )
+{
+	return l->logbytes >= MINSNAPLOG && l->logbytes >= l->snapbytes;
+}
+
+
+/*
+ * famlogSnapshotBegin( l );
+ *	Start writing a new snapshot: follow this with one call of
+ *	famlogSnapshotPair() for every pair in the collection, each
+ *	family's pairs together, and then famlogSnapshotEnd().
+ */
+void famlogSnapshotBegin( famlog l )
+{
+	assert( l->snap == NULL );
+	char *path = pathof( l, "snapshot.tmp" );
+	l->snap = fopen( path, "w" );
+	if( l->snap == NULL )
+	{
+		fail( "fopen", path );
+	}
+	free( path );
+	fwrite( SNAPMAGIC, 1, SNAPMAGICLEN, l->snap );
+	l->snapbytes = SNAPMAGICLEN;
+}
+
+
+static void snapname( famlog l, char *name, int isparent )
+{
+	uint32_t len = strlen( name );
+	uint32_t word = len << 1 | isparent;
+	fwrite( &word, 4, 1, l->snap );
+	fwrite( name, 1, len, l->snap );
+	l->snapbytes += 4 + len;
+}
+
+
+/*
+ * famlogSnapshotPair( l, parent, child );
+ *	Write one pair into the snapshot being written.
+ */
+void famlogSnapshotPair( famlog l, char *parent, char *child )
+{
+	assert( l->snap != NULL );
+	if( l->lastparent == NULL || strcmp( parent, l->lastparent ) != 0 )
+	{
+		free( l->lastparent );
+		l->lastparent = strdup( parent );
+		snapname( l, parent, 1 );
+	}
+	snapname( l, child, 0 );
+}
+
+
+/*
+ * famlogSnapshotEnd( l );
+ *	Finish the snapshot being written, make it durable, install it
+ *	in place of the previous one, and empty the log.  If any write
+ *	to the new snapshot failed, say so and discard it instead: the
+ *	old snapshot and the log still hold every pair.
+ */
+void famlogSnapshotEnd( famlog l )
+{
+	assert( l->snap != NULL );
+	bool ok = fflush( l->snap ) == 0 && ! ferror( l->snap ) &&
+		  fsync( fileno(l->snap) ) == 0;
+	if( fclose( l->snap ) != 0 )
+	{
+		ok = false;
+	}
+	l->snap = NULL;
+	free( l->lastparent );
+	l->lastparent = NULL;
+
+	char *tmp = pathof( l, "snapshot.tmp" );
+	if( ! ok )
+	{
+		fprintf( stderr, "famlog: " );
+		perror( tmp );
+		unlink( tmp );
+		free( tmp );
+		return;		/* snapbytes stays grown, so retries back off */
+	}
+	char *path = pathof( l, "snapshot" );
+	if( rename( tmp, path ) < 0 )
+	{
+		fail( "rename", path );
+	}
+	free( tmp );
+	free( path );
+	int dirfd = open( l->dir, O_RDONLY );
+	if( dirfd >= 0 )
+	{
+		fsync( dirfd );		/* make the rename durable too */
+		close( dirfd );
+	}
+
+	l->buflen = 0;		/* those pairs are in the snapshot now */
+	if( ftruncate( l->logfd, 0 ) < 0 || fsync( l->logfd ) < 0 )
+	{
+		fail( "ftruncate", "log" );
+	}
+	l->logbytes = 0;
+}
+
+
+/*
+ * famlogClose( l );
+ *	Sync and close l, and free it.
+ */
+void famlogClose( famlog l )
+{
+	assert( l->snap == NULL );
+	famlogSync( l );
+	close( l->logfd );
+	free( l->dir );
+	free( l->name[0] );
+	free( l->name[1] );
+	free( (void *)l );
+}
@@ -0,0 +1,19 @@
+/*
+ * famlog.h: persistence for a family collection: an append-only log
+ *	     of added (parent, child) pairs plus a compact snapshot,
+ *	     both kept in one directory.
+ */
+
+typedef struct famlog_s *famlog;
+
+/* a famlog pair callback is called once per (parent, child) pair read back */
+typedef void (*famlogpaircb)( char * parent, char * child, void * arg );
+
+extern famlog famlogOpen( char * dir, famlogpaircb cb, void * arg );
+extern void famlogAppend( famlog l, char * parent, char * child );
+extern void famlogSync( famlog l );
+extern bool famlogWantSnapshot( famlog l );
+extern void famlogSnapshotBegin( famlog l );
+extern void famlogSnapshotPair( famlog l, char * parent, char * child );
+extern void famlogSnapshotEnd( famlog l );
+extern void famlogClose( famlog l );
@@ -0,0 +1,37 @@
+/*
+ * famproto.h: the binary protocol spoken between famserver and its
+ *	       clients (see famclient.c) over a UNIX domain socket.
+ *
+ *	Every message, in either direction, is a frame: a 32-bit length
+ *	of the rest of the frame, then the rest.  The rest of a request
+ *	is a one-byte opcode followed by its arguments; the rest of a
+ *	response is a one-byte status followed by its results.  A string
+ *	is a 32-bit length followed by that many bytes.  All integers
+ *	are in host byte order: both ends are on the same host.
+ *
+ *	Responses come back in the order the requests were sent, so a
+ *	client may send many requests before reading any responses
+ *	(pipelining), and the server answers all the requests it has
+ *	read before writing the answers back in one go.
+ *
+ *	request				response (after FAM_OK)
+ *	FAM_ISCHILD parent child	byte: 1 if child is a child of parent, else 0
+ *	FAM_CHILDREN parent		count, then count strings (sorted)
+ *	FAM_NFAMILIES			count
+ *	FAM_PARENTS child		count, then count strings
+ *	FAM_ISCHILDBATCH n, then n (parent, child) string pairs
+ *					n bytes, each as for FAM_ISCHILD
+ *
+ *	A malformed request gets a FAM_BADREQUEST status and nothing else.
+ */
+
+#define	FAM_ISCHILD		1
+#define	FAM_CHILDREN		2
+#define	FAM_NFAMILIES		3
+#define	FAM_PARENTS		4
+#define	FAM_ISCHILDBATCH	5
+
+#define	FAM_OK			0
+#define	FAM_BADREQUEST		1
+
+#define	FAM_MAXFRAME		(64*1024*1024)	/* biggest frame accepted */
@@ -0,0 +1,562 @@
+/*
+ * famreach.c: reachability (ancestor/descendant) queries over a
+ *	       directed graph of named people, each edge running from
+ *	       a parent to one of their children.
+ *
+ *	Each name is interned as a small integer id, with adjacency
+ *	lists of ids.  To answer queries, we condense the graph into
+ *	its strongly connected components (everyone in a cycle can
+ *	reach everyone else in it, so they share one answer), which
+ *	form a DAG, and compute the transitive closure of that DAG as
+ *	one bitset per component: bit d of reach[c] is set iff some
+ *	path of one or more edges leads from component c to component
+ *	d.  Then "is D a descendant of A?" is a single bit test.
+ *
+ *	The closure is built lazily on the first query after it is
+ *	invalidated.  An edge added between existing people that does
+ *	not create a new cycle is folded into the closure immediately
+ *	(every component that reaches the parent now also reaches the
+ *	child and all the child's descendants).  The bitsets are built
+ *	with about 1/8 spare room, so a new person simply becomes a new
+ *	component with an empty bitset; only a new cycle, or running out
+ *	of room, invalidates the closure.
+ *
+ *	The closure needs ncomponents^2 bits, eg. 100,000 people with
+ *	no cycles would need about 1.2GB.  So if it would need more than
+ *	FAMREACH_MAXBYTES (or can't be allocated), we don't build it, and
+ *	answer each query by a depth first search of the people instead,
+ *	following child edges for descendants and parent edges for
+ *	ancestors: O(people+edges) per query, but only O(people) bits
+ *	of workspace.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <hash.h>
+#include <set.h>
+
+#include "famreach.h"
+
+
+#ifndef FAMREACH_MAXBYTES
+#define FAMREACH_MAXBYTES	(128*1024*1024)	/* biggest closure we'll build */
+#endif
+
+typedef struct		/* a growable array of ids */
+{
+	int *a;
+	int  n;
+	int  cap;
+} idlist;
+
+struct famreach_s
+{
+	hash	 ids;		/* name -> id+1 */
+	char **	 name;		/* id -> name */
+	idlist * out;		/* id -> ids of their children */
+	idlist * in;		/* id -> ids of their parents */
+	int	 n;		/* number of people */
+	int	 cap;
+
+	bool	 valid;		/* are comp, ncomps and reach up to date? */
+	int *	 comp;		/* id -> component number (cap entries) */
+	int	 ncomps;
+	int	 words;		/* uint64_t words per bitset */
+	uint64_t *reach;	/* words*64 bitsets of words words each, */
+				/* or NULL: search instead */
+
+	uint64_t *seen;		/* search: who we've reached, a bit each */
+	int *	 todo;		/* search: stack of people to expand */
+	int	 searchcap;	/* people seen and todo have room for */
+};
+
+
+#define BIT(bs,i)	(((bs)[(i)>>6] >> ((i)&63)) & 1)
+#define SETBIT(bs,i)	((bs)[(i)>>6] |= (uint64_t)1 << ((i)&63))
+
+
+static void nofree( hashvalue v )
+{
+}
+
+
+static void idpush( idlist *l, int id )
+{
+	if( l->n == l->cap )
+	{
+		l->cap = l->cap == 0 ? 4 : l->cap * 2;
+		l->a = (int *) realloc( l->a, l->cap * sizeof(int) );
+		assert( l->a != NULL );
+	}
+	l->a[l->n++] = id;
+}
+
+
+/*
+ * famreach r = famreachCreate();
+ *	Create an empty graph.
+ */
+famreach famreachCreate( void )
+{
+	famreach r = (famreach) malloc( sizeof(struct famreach_s) );
+	assert( r != NULL );
+	r->ids = hashCreate( NULL, &nofree, NULL );
+	r->n = 0;
+	r->cap = 64;
+	r->name = (char **) malloc( r->cap * sizeof(char *) );
+	r->out = (idlist *) calloc( r->cap, sizeof(idlist) );
+	r->in = (idlist *) calloc( r->cap, sizeof(idlist) );
+	assert( r->name != NULL && r->out != NULL && r->in != NULL );
+	r->valid = false;
+	r->comp = NULL;
+	r->reach = NULL;
+	r->seen = NULL;
+	r->todo = NULL;
+	r->searchcap = 0;
+	return r;
+}
+
+
+/*
+ * famreachFree( r );
+ *	Free graph r.
+ */
+void famreachFree( famreach r )
+{
+	int i;
+	for( i = 0; i < r->n; i++ )
+	{
+		free( (void *)r->out[i].a );
+		free( (void *)r->in[i].a );
+		free( (void *)r->name[i] );
+	}
+	free( (void *)r->out );
+	free( (void *)r->in );
+	free( (void *)r->name );
+	free( (void *)r->comp );
+	free( (void *)r->reach );
+	free( (void *)r->seen );
+	free( (void *)r->todo );
+	hashFree( r->ids );
+	free( (void *)r );
+}
+
+
+/*
+ * int id = lookup( r, name );
+ *	Return name's id, or -1 if name isn't in r.
+ */
+static int lookup( famreach r, char *name )
+{
+	return (int)(intptr_t)hashFind( r->ids, name ) - 1;
+}
+
+
+/*
+ * int id = intern( r, name );
+ *	Return name's id, adding name to r if it's new: as a new
+ *	component of the closure if it has room for one.
+ */
+static int intern( famreach r, char *name )
+{
+	int id = lookup( r, name );
+	if( id >= 0 )
+	{
+		return id;
+	}
+	if( r->n == r->cap )
+	{
+		r->cap *= 2;
+		r->name = (char **) realloc( r->name, r->cap * sizeof(char *) );
+		r->out = (idlist *) realloc( r->out, r->cap * sizeof(idlist) );
+		r->in = (idlist *) realloc( r->in, r->cap * sizeof(idlist) );
+		assert( r->name != NULL && r->out != NULL && r->in != NULL );
+		memset( r->out + r->n, 0, (r->cap - r->n) * sizeof(idlist) );
+		memset( r->in + r->n, 0, (r->cap - r->n) * sizeof(idlist) );
+		if( r->comp != NULL )
+		{
+			r->comp = (int *) realloc( r->comp, r->cap * sizeof(int) );
+			assert( r->comp != NULL );
+		}
+	}
+	id = r->n++;
+	hashSet( r->ids, name, (hashvalue)(intptr_t)(id+1) );
+	r->name[id] = strdup( name );
+	if( r->valid && r->reach != NULL )
+	{
+		if( r->ncomps < r->words * 64 )
+		{
+			r->comp[id] = r->ncomps++;	/* its bitset is empty */
+		} else
+		{
+			r->valid = false;	/* no room: rebuild later */
+		}
+	}
+	return id;
+}
+
+
+/*
+ * famreachAddEdge( r, parent, child );
+ *	Record that child is a child of parent.  Adding the same edge
+ *	twice is harmless but wasteful.
+ */
+void famreachAddEdge( famreach r, char *parent, char *child )
+{
+	int u = intern( r, parent );
+	int v = intern( r, child );
+	idpush( &r->out[u], v );
+	idpush( &r->in[v], u );
+
+	if( ! r->valid || r->reach == NULL )
+	{
+		return;
+	}
+	int cu = r->comp[u];
+	int cv = r->comp[v];
+	uint64_t *rv = r->reach + (size_t)cv * r->words;
+	if( cu == cv || BIT(rv, cu) )
+	{
+		r->valid = false;	/* a new cycle: rebuild later */
+		return;
+	}
+	int c;
+	for( c = 0; c < r->ncomps; c++ )
+	{
+		uint64_t *rc = r->reach + (size_t)c * r->words;
+		if( c == cu || BIT(rc, cu) )
+		{
+			int w;
+			for( w = 0; w < r->words; w++ )
+			{
+				rc[w] |= rv[w];
+			}
+			SETBIT( rc, cv );
+		}
+	}
+}
+
+
+/*
+ * build( r );
+ *	Find the strongly connected components of r (by an iterative
+ *	version of Tarjan's algorithm), and compute their closure, unless
+ *	it would be too big: then leave r->reach NULL, to search instead.
+ */
+static void build( famreach r )
+{
+	int n = r->n;
+	int *index = (int *) malloc( (n+1) * sizeof(int) );
+	int *low = (int *) malloc( (n+1) * sizeof(int) );
+	int *stack = (int *) malloc( (n+1) * sizeof(int) );
+	bool *onstack = (bool *) calloc( n+1, sizeof(bool) );
+	int *callv = (int *) malloc( (n+1) * sizeof(int) );
+	int *calle = (int *) malloc( (n+1) * sizeof(int) );
+	free( (void *)r->comp );
+	r->comp = (int *) malloc( r->cap * sizeof(int) );
+	assert( index && low && stack && onstack && callv && calle && r->comp );
+
+	int i;
+	for( i = 0; i < n; i++ )
+	{
+		index[i] = -1;
+	}
+	int next = 0;
+	int sp = 0;
+	r->ncomps = 0;
+
+	/* Tarjan, with an explicit call stack of (vertex, next edge) */
+	int root;
+	for( root = 0; root < n; root++ )
+	{
+		if( index[root] >= 0 )
+		{
+			continue;
+		}
+		int depth = 0;
+		callv[0] = root; calle[0] = 0;
+		index[root] = low[root] = next++;
+		stack[sp++] = root; onstack[root] = true;
+		while( depth >= 0 )
+		{
+			int v = callv[depth];
+			if( calle[depth] < r->out[v].n )
+			{
+				int w = r->out[v].a[calle[depth]++];
+				if( index[w] < 0 )
+				{
+					index[w] = low[w] = next++;
+					stack[sp++] = w; onstack[w] = true;
+					depth++;
+					callv[depth] = w; calle[depth] = 0;
+				} else if( onstack[w] && index[w] < low[v] )
+				{
+					low[v] = index[w];
+				}
+				continue;
+			}
+			/* finished v */
+			if( low[v] == index[v] )
+			{
+				int w;
+				do
+				{
+					w = stack[--sp];
+					onstack[w] = false;
+					r->comp[w] = r->ncomps;
+				} while( w != v );
+				r->ncomps++;
+			}
+			depth--;
+			if( depth >= 0 )
+			{
+				int u = callv[depth];
+				if( low[v] < low[u] )
+				{
+					low[u] = low[v];
+				}
+			}
+		}
+	}
+
+	/*
+	 * Tarjan numbers the components in reverse topological order:
+	 * every edge leads to a component numbered no higher, so we can
+	 * compute each component's closure from lower-numbered ones.
+	 * First bucket the people by component (a counting sort).
+	 */
+	int nc = r->ncomps;
+	int *start = (int *) calloc( nc+1, sizeof(int) );
+	int *member = (int *) malloc( (n+1) * sizeof(int) );
+	assert( start != NULL && member != NULL );
+	for( i = 0; i < n; i++ )
+	{
+		start[r->comp[i]+1]++;
+	}
+	for( i = 0; i < nc; i++ )
+	{
+		start[i+1] += start[i];
+	}
+	int *fill = (int *) malloc( (nc+1) * sizeof(int) );
+	assert( fill != NULL );
+	memcpy( fill, start, nc * sizeof(int) );
+	for( i = 0; i < n; i++ )
+	{
+		member[fill[r->comp[i]]++] = i;
+	}
+
+	r->words = (nc + nc/8 + 64) / 64;	/* leave room for new people */
+	size_t nwords = (size_t)r->words * 64 * r->words;
+	free( (void *)r->reach );
+	r->reach = NULL;
+	if( nwords * sizeof(uint64_t) <= FAMREACH_MAXBYTES )
+	{
+		r->reach = (uint64_t *) calloc( nwords, sizeof(uint64_t) );
+	}
+	int c;
+	for( c = 0; r->reach != NULL && c < nc; c++ )
+	{
+		uint64_t *rc = r->reach + (size_t)c * r->words;
+		int m;
+		for( m = start[c]; m < start[c+1]; m++ )
+		{
+			idlist *l = &r->out[member[m]];
+			int e;
+			for( e = 0; e < l->n; e++ )
+			{
+				int d = r->comp[l->a[e]];
+				/* if d's already in, so is d's closure */
+				if( d != c && ! BIT(rc, d) )
+				{
+					uint64_t *rd = r->reach + (size_t)d * r->words;
+					int w;
+					for( w = 0; w < r->words; w++ )
+					{
+						rc[w] |= rd[w];
+					}
+				}
+				SETBIT( rc, d );
+			}
+		}
+	}
+
+	free( (void *)fill );
+	free( (void *)member );
+	free( (void *)start );
+	free( (void *)calle );
+	free( (void *)callv );
+	free( (void *)onstack );
+	free( (void *)stack );
+	free( (void *)low );
+	free( (void *)index );
+	r->valid = true;
+}
+
+
+/*
+ * bool found = search( r, from, adj, stop );
+ *	Depth first search from person from along adjacency lists adj
+ *	(r->out to find descendants, r->in to find ancestors), setting
+ *	the bit in r->seen of everyone reached by one or more edges.
+ *	Stop early, returning true, if person stop is reached (pass -1
+ *	to search everything).
+ */
+static bool search( famreach r, int from, idlist *adj, int stop )
+{
+	if( r->searchcap < r->n )
+	{
+		r->searchcap = r->cap;
+		free( (void *)r->seen );
+		free( (void *)r->todo );
+		r->seen = (uint64_t *) malloc( (r->searchcap/64 + 1) * sizeof(uint64_t) );
+		r->todo = (int *) malloc( (r->searchcap + 1) * sizeof(int) );
+		assert( r->seen != NULL && r->todo != NULL );
+	}
+	memset( r->seen, 0, (r->n/64 + 1) * sizeof(uint64_t) );
+
+	/* everyone is pushed at most once, when first seen, plus from */
+	int sp = 0;
+	r->todo[sp++] = from;
+	while( sp > 0 )
+	{
+		idlist *l = &adj[r->todo[--sp]];
+		int e;
+		for( e = 0; e < l->n; e++ )
+		{
+			int w = l->a[e];
+			if( ! BIT(r->seen, w) )
+			{
+				SETBIT( r->seen, w );
+				if( w == stop )
+				{
+					return true;
+				}
+				r->todo[sp++] = w;
+			}
+		}
+	}
+	return false;
+}
+
+
+/*
+ * addseen( r, s );
+ *	Add everyone the last search() reached to set s.
+ */
+static void addseen( famreach r, set s )
+{
+	int i;
+	for( i = 0; i < r->n; i++ )
+	{
+		if( BIT( r->seen, i ) )
+		{
+			setAdd( s, r->name[i] );
+		}
+	}
+}
+
+
+/*
+ * bool isdesc = famreachIsDescendant( r, ancestor, descendant );
+ *	Is there a path of one or more parent->child edges from
+ *	ancestor to descendant?
+ */
+bool famreachIsDescendant( famreach r, char *ancestor, char *descendant )
+{
+	int a = lookup( r, ancestor );
+	int d = lookup( r, descendant );
+	if( a < 0 || d < 0 )
+	{
+		return false;
+	}
+	if( ! r->valid )
+	{
+		build( r );
+	}
+	if( r->reach == NULL )
+	{
+		return search( r, a, r->out, d );
+	}
+	uint64_t *ra = r->reach + (size_t)r->comp[a] * r->words;
+	return BIT( ra, r->comp[d] );
+}
+
+
+/*
+ * set s = famreachDescendants( r, person );
+ *	Return a new set of all person's descendants (which includes
+ *	person themself only if they're their own ancestor, via a cycle).
+ *	The caller should setFree() it.
+ */
+set famreachDescendants( famreach r, char *person )
+{
+	set result = setCreate( NULL );
+	int p = lookup( r, person );
+	if( p < 0 )
+	{
+		return result;
+	}
+	if( ! r->valid )
+	{
+		build( r );
+	}
+	if( r->reach == NULL )
+	{
+		search( r, p, r->out, -1 );
+		addseen( r, result );
+		return result;
+	}
+	uint64_t *rp = r->reach + (size_t)r->comp[p] * r->words;
+	int i;
+	for( i = 0; i < r->n; i++ )
+	{
+		if( BIT( rp, r->comp[i] ) )
+		{
+			setAdd( result, r->name[i] );
+		}
+	}
+	return result;
+}
+
+
+/*
+ * set s = famreachAncestors( r, person );
+ *	Return a new set of all person's ancestors (which includes
+ *	person themself only if they're their own ancestor, via a cycle).
+ *	The caller should setFree() it.
+ */
+set famreachAncestors( famreach r, char *person )
+{
+	set result = setCreate( NULL );
+	int p = lookup( r, person );
+	if( p < 0 )
+	{
+		return result;
+	}
+	if( ! r->valid )
+	{
+		build( r );
+	}
+	if( r->reach == NULL )
+	{
+		search( r, p, r->in, -1 );
+		addseen( r, result );
+		return result;
+	}
+	int cp = r->comp[p];
+	int i;
+	for( i = 0; i < r->n; i++ )
+	{
+		uint64_t *ri = r->reach + (size_t)r->comp[i] * r->words;
+		if( BIT( ri, cp ) )
+		{
+			setAdd( result, r->name[i] );
+		}
+	}
+	return result;
+}
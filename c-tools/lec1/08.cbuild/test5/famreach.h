@@ -0,0 +1,14 @@
+/*
+ * famreach.h: reachability (ancestor/descendant) queries over a
+ *	       directed graph of named people, each edge running from
+ *	       a parent to one of their children.
+ */
+
+typedef struct famreach_s *famreach;
+
+extern famreach famreachCreate( void );
+extern void famreachFree( famreach r );
+extern void famreachAddEdge( famreach r, char * parent, char * child );
+extern bool famreachIsDescendant( famreach r, char * ancestor, char * descendant );
+extern set famreachDescendants( famreach r, char * person );
+extern set famreachAncestors( famreach r, char * person );
@@ -0,0 +1,560 @@
+/*
+ *   famserver: load a family collection once, then answer queries
+ *		about it over a UNIX domain socket, using the protocol
+ *		in famproto.h (and see famclient.c for a client).
+ *
+ *		usage: famserver [-d dir] socketpath [< input]
+ *		the families are read as "parent: child" lines from
+ *		input, or with -d, loaded from the persistent collection
+ *		in directory dir.  They are then frozen (see famfrozen.c),
+ *		with a reverse index for parents queries.
+ *
+ *	The server is a single thread running a poll() loop over all
+ *	the client connections, which are non-blocking.  Whenever a
+ *	connection is readable, we read everything that's there, answer
+ *	every whole request in it into the connection's output buffer,
+ *	and then write as much of that as the socket will take: so a
+ *	pipelining client gets all its answers in one write().
+ *
+ *	A client that sends requests faster than it reads the answers
+ *	is held back: once OUTCAP bytes of answers are waiting, we stop
+ *	answering and reading its requests, and its input buffer never
+ *	holds more than one biggest frame.  If no answers can be written
+ *	to it for STALLSECS seconds, it's disconnected.  And when we run
+ *	out of file descriptors, we stop accepting connections until one
+ *	closes (or a second passes).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <set.h>
+
+#include "famcoll.h"
+#include "ingest.h"
+#include "famproto.h"
+
+
+#define	OUTCAP		(1024*1024)	/* stop reading with this much to write */
+#define	INCAP		(FAM_MAXFRAME+4)	/* biggest input buffer */
+#define	STALLSECS	10		/* drop a client stuck over OUTCAP this long */
+
+typedef struct		/* a growable byte buffer */
+{
+	char *	s;
+	int	len;
+	int	cap;
+} buffer;
+
+typedef struct		/* one client connection */
+{
+	int	fd;
+	buffer	in;		/* bytes read, not yet a whole request */
+	buffer	out;		/* responses not yet written */
+	int	outpos;		/* how much of out has been written */
+	time_t	stalled;	/* when out went over OUTCAP unwritten, or 0 */
+} conn;
+
+
+static famcoll f;
+static volatile sig_atomic_t stop = 0;
+
+
+static void onsignal( int sig )
+{
+	stop = 1;
+}
+
+
+static void put( buffer *b, void *p, int len )
+{
+	if( b->len + len > b->cap )
+	{
+		b->cap = (b->len + len) * 2;
+		b->s = realloc( b->s, b->cap );
+		assert( b->s != NULL );
+	}
+	memcpy( b->s + b->len, p, len );
+	b->len += len;
+}
+
+static void putu32( buffer *b, uint32_t x )
+{
+	put( b, &x, 4 );
+}
+
+static void putbyte( buffer *b, int x )
+{
+	unsigned char c = x;
+	put( b, &c, 1 );
+}
+
+
+/* a request being parsed: its arguments run from p up to end */
+typedef struct
+{
+	char *	p;
+	char *	end;
+} request;
+
+static bool getu32( request *r, uint32_t *x )
+{
+	if( r->end - r->p < 4 )
+	{
+		return false;
+	}
+	memcpy( x, r->p, 4 );
+	r->p += 4;
+	return true;
+}
+
+
+/*
+ * bool ok = getstr( r, which, &s );
+ *	Take a string from request r, copying it into '\0' terminated
+ *	scratch buffer number which (0 or 1), and set s to it.
+ */
+static bool getstr( request *r, int which, char **s )
+{
+	static char *scratch[2];
+	static uint32_t cap[2];
+	uint32_t len;
+	if( ! getu32( r, &len ) || (uint32_t)(r->end - r->p) < len )
+	{
+		return false;
+	}
+	if( len + 1 > cap[which] )
+	{
+		cap[which] = (len + 1) * 2;
+		scratch[which] = realloc( scratch[which], cap[which] );
+		assert( scratch[which] != NULL );
+	}
+	memcpy( scratch[which], r->p, len );
+	scratch[which][len] = '\0';
+	r->p += len;
+	*s = scratch[which];
+	return true;
+}
+
+
+/* name callback: append one name to a response, counting them */
+typedef struct { buffer *b; uint32_t n; } namesarg;
+static void putname_cb( setkey name, void *arg )
+{
+	namesarg *na = (namesarg *)arg;
+	uint32_t len = strlen( name );
+	putu32( na->b, len );
+	put( na->b, name, len );
+	na->n++;
+}
+
+
+/*
+ * bool ok = answer( r, out );
+ *	Answer the request in r (after its opcode, which is at r->p),
+ *	appending the response's status and results to out.  Return
+ *	false if the request is malformed.
+ */
+static bool answer( request *r, buffer *out )
+{
+	int op = (unsigned char)*r->p++;
+	char *parent, *child;
+	uint32_t n, i;
+	namesarg na;
+	switch( op )
+	{
+	case FAM_ISCHILD:
+		if( ! getstr( r, 0, &parent ) || ! getstr( r, 1, &child ) )
+		{
+			return false;
+		}
+		putbyte( out, FAM_OK );
+		putbyte( out, famcollIsChild( f, parent, child ) );
+		break;
+
+	case FAM_CHILDREN:
+	case FAM_PARENTS:
+		if( ! getstr( r, 0, &parent ) )
+		{
+			return false;
+		}
+		putbyte( out, FAM_OK );
+		int countpos = out->len;
+		putu32( out, 0 );
+		na.b = out; na.n = 0;
+		if( op == FAM_CHILDREN )
+		{
+			famcollForeachChild( f, parent, &putname_cb, (void *)&na );
+		} else
+		{
+			famcollForeachParent( f, parent, &putname_cb, (void *)&na );
+		}
+		memcpy( out->s + countpos, &na.n, 4 );
+		break;
+
+	case FAM_NFAMILIES:
+		putbyte( out, FAM_OK );
+		putu32( out, famcollNFamilies( f ) );
+		break;
+
+	case FAM_ISCHILDBATCH:
+		if( ! getu32( r, &n ) || n > (uint32_t)(r->end - r->p) / 8 )
+		{
+			return false;
+		}
+		int start = out->len;
+		putbyte( out, FAM_OK );
+		for( i = 0; i < n; i++ )
+		{
+			if( ! getstr( r, 0, &parent ) || ! getstr( r, 1, &child ) )
+			{
+				out->len = start;
+				return false;
+			}
+			putbyte( out, famcollIsChild( f, parent, child ) );
+		}
+		break;
+
+	default:
+		return false;
+	}
+	return r->p == r->end;
+}
+
+
+/*
+ * bool ok = serve( c );
+ *	Answer every whole request in c's input buffer, appending the
+ *	response frames to c's output buffer, until OUTCAP bytes of
+ *	responses are waiting to be written.  Return false if the client
+ *	has sent something unacceptable, and should be disconnected.
+ */
+static bool serve( conn *c )
+{
+	int pos = 0;
+	while( c->in.len - pos >= 4 && c->out.len - c->outpos < OUTCAP )
+	{
+		uint32_t len;
+		memcpy( &len, c->in.s + pos, 4 );
+		if( len < 1 || len > FAM_MAXFRAME )
+		{
+			return false;
+		}
+		if( c->in.len - pos - 4 < len )
+		{
+			break;		/* the rest hasn't arrived yet */
+		}
+		request r;
+		r.p = c->in.s + pos + 4;
+		r.end = r.p + len;
+		int start = c->out.len;
+		putu32( &c->out, 0 );
+		if( ! answer( &r, &c->out ) )
+		{
+			c->out.len = start + 4;
+			putbyte( &c->out, FAM_BADREQUEST );
+		}
+		uint32_t outlen = c->out.len - start - 4;
+		memcpy( c->out.s + start, &outlen, 4 );
+		pos += 4 + len;
+	}
+	memmove( c->in.s, c->in.s + pos, c->in.len - pos );
+	c->in.len -= pos;
+	return true;
+}
+
+
+/*
+ * bool ok = readsome( c );
+ *	Read everything that's waiting on c's socket, or until c's input
+ *	buffer holds INCAP bytes.  Return false on end of file or error.
+ */
+static bool readsome( conn *c )
+{
+	while( c->in.len < INCAP )
+	{
+		if( c->in.cap - c->in.len < 65536 && c->in.cap < INCAP )
+		{
+			c->in.cap = c->in.cap * 2 + 65536;
+			if( c->in.cap > INCAP )
+			{
+				c->in.cap = INCAP;
+			}
+			c->in.s = realloc( c->in.s, c->in.cap );
+			assert( c->in.s != NULL );
+		}
+		ssize_t n = read( c->fd, c->in.s + c->in.len, c->in.cap - c->in.len );
+		if( n > 0 )
+		{
+			c->in.len += n;
+			continue;
+		}
+		if( n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+		{
+			return true;
+		}
+		if( n < 0 && errno == EINTR )
+		{
+			continue;
+		}
+		return false;
+	}
+	return true;
+}
+
+
+/*
+ * bool ok = writesome( c );
+ *	Write as much of c's output as the socket will take, moving
+ *	what's left to the front of the buffer.  Return false on error.
+ */
+static bool writesome( conn *c )
+{
+	while( c->outpos < c->out.len )
+	{
+		ssize_t n = write( c->fd, c->out.s + c->outpos, c->out.len - c->outpos );
+		if( n < 0 )
+		{
+			memmove( c->out.s, c->out.s + c->outpos, c->out.len - c->outpos );
+			c->out.len -= c->outpos;
+			c->outpos = 0;
+			return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+		}
+		c->outpos += n;
+		c->stalled = 0;
+	}
+	c->out.len = c->outpos = 0;
+	return true;
+}
+
+
+/*
+ * bool ok = pump( c, ev );
+ *	Handle poll() events ev on connection c: read what's there,
+ *	then answer and write until the socket is full or there are no
+ *	more whole requests.  Return false if c should be disconnected.
+ */
+static bool pump( conn *c, short ev )
+{
+	bool ok = true;
+	if( ev & (POLLIN|POLLHUP|POLLERR) )
+	{
+		ok = readsome( c );
+	}
+	for(;;)
+	{
+		int before = c->in.len;
+		ok = serve( c ) && ok;
+		if( c->outpos < c->out.len )
+		{
+			ok = writesome( c ) && ok;
+		}
+		if( ! ok || c->in.len == before || c->outpos < c->out.len )
+		{
+			break;
+		}
+	}
+	if( c->out.len - c->outpos < OUTCAP )
+	{
+		c->stalled = 0;
+	} else if( c->stalled == 0 )
+	{
+		c->stalled = time( NULL );
+	} else if( time( NULL ) - c->stalled >= STALLSECS )
+	{
+		ok = false;		/* not reading its answers */
+	}
+	return ok;
+}
+
+
+static void setnonblocking( int fd )
+{
+	fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+}
+
+
+/*
+ * int fd = listenon( path );
+ *	Listen on UNIX domain socket path, replacing any stale socket.
+ */
+static int listenon( char *path )
+{
+	struct sockaddr_un addr;
+	if( strlen(path) >= sizeof(addr.sun_path) )
+	{
+		fprintf( stderr, "famserver: socket path %s too long\n", path );
+		exit(1);
+	}
+	int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+	if( fd < 0 )
+	{
+		perror( "famserver: socket" );
+		exit(1);
+	}
+	memset( &addr, 0, sizeof(addr) );
+	addr.sun_family = AF_UNIX;
+	strcpy( addr.sun_path, path );
+	unlink( path );
+	if( bind( fd, (struct sockaddr *)&addr, sizeof(addr) ) < 0 ||
+	    listen( fd, 128 ) < 0 )
+	{
+		perror( path );
+		exit(1);
+	}
+	setnonblocking( fd );
+	return fd;
+}
+
+
+/*
+ * serveforever( lfd );
+ *	Accept connections on lfd and answer their requests, until
+ *	we're asked to stop by a signal.
+ */
+static void serveforever( int lfd )
+{
+	int cap = 16;
+	conn *c = (conn *) malloc( cap * sizeof(conn) );
+	struct pollfd *pfd = (struct pollfd *) malloc( (cap+1) * sizeof(struct pollfd) );
+	assert( c != NULL && pfd != NULL );
+	int nconns = 0;
+	bool accepting = true;	/* false while out of file descriptors */
+
+	while( ! stop )
+	{
+		pfd[0].fd = lfd;
+		pfd[0].events = accepting ? POLLIN : 0;
+		int timeout = accepting ? -1 : 1000;
+		int i;
+		for( i = 0; i < nconns; i++ )
+		{
+			int pending = c[i].out.len - c[i].outpos;
+			pfd[i+1].fd = c[i].fd;
+			pfd[i+1].events = pending > 0 ? POLLOUT : 0;
+			if( pending < OUTCAP && c[i].in.len < INCAP )
+			{
+				pfd[i+1].events |= POLLIN;
+			}
+			if( c[i].stalled != 0 )
+			{
+				timeout = 1000;
+			}
+		}
+		int nready = poll( pfd, nconns+1, timeout );
+		if( nready < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			perror( "famserver: poll" );
+			exit(1);
+		}
+		if( nready == 0 )
+		{
+			accepting = true;	/* try again, once a second */
+		}
+
+		/* serve existing connections, dropping dead ones */
+		int nalive = 0;
+		for( i = 0; i < nconns; i++ )
+		{
+			if( pump( &c[i], pfd[i+1].revents ) )
+			{
+				c[nalive++] = c[i];
+			} else
+			{
+				close( c[i].fd );
+				free( c[i].in.s );
+				free( c[i].out.s );
+				accepting = true;
+			}
+		}
+		nconns = nalive;
+
+		/* and accept new ones */
+		if( pfd[0].revents & POLLIN )
+		{
+			int fd;
+			while( (fd = accept( lfd, NULL, NULL )) >= 0 )
+			{
+				setnonblocking( fd );
+				if( nconns == cap )
+				{
+					cap *= 2;
+					c = (conn *) realloc( c, cap * sizeof(conn) );
+					pfd = (struct pollfd *) realloc( pfd,
+						(cap+1) * sizeof(struct pollfd) );
+					assert( c != NULL && pfd != NULL );
+				}
+				memset( &c[nconns], 0, sizeof(conn) );
+				c[nconns++].fd = fd;
+			}
+			if( errno == EMFILE || errno == ENFILE )
+			{
+				/* the listener stays readable: stop polling it */
+				perror( "famserver: accept" );
+				accepting = false;
+			}
+		}
+	}
+
+	int i;
+	for( i = 0; i < nconns; i++ )
+	{
+		close( c[i].fd );
+		free( c[i].in.s );
+		free( c[i].out.s );
+	}
+	free( (void *)c );
+	free( (void *)pfd );
+}
+
+
+int main( int argc, char **argv )
+{
+	char *dir = NULL;
+	if( argc == 4 && strcmp( argv[1], "-d" ) == 0 )
+	{
+		dir = argv[2];
+	} else if( argc != 2 )
+	{
+		fprintf( stderr, "Usage: famserver [-d dir] socketpath [< input]\n" );
+		exit(1);
+	}
+	char *path = argv[argc-1];
+
+	f = dir != NULL ? famcollOpen( dir ) : ingestParallel( 0, 1 );
+	famcollEnableParents( f );
+	famcollFreeze( f );
+
+	int lfd = listenon( path );
+	struct sigaction sa;
+	memset( &sa, 0, sizeof(sa) );
+	sa.sa_handler = &onsignal;
+	sigaction( SIGINT, &sa, NULL );
+	sigaction( SIGTERM, &sa, NULL );
+	signal( SIGPIPE, SIG_IGN );
+	fprintf( stderr, "famserver: serving %d families on %s\n",
+		 famcollNFamilies( f ), path );
+
+	serveforever( lfd );
+
+	close( lfd );
+	unlink( path );
+	famcollFree( f );
+	return 0;
+}
@@ -0,0 +1,276 @@
+/*
+ * famstats.c: incrementally maintained statistics about the sizes
+ *	       of families: a histogram of children per family, and
+ *	       the k largest families.
+ *
+ *	Families are identified by small integers (famcoll uses the
+ *	multimap's key index) plus their parent's name.  Every time a
+ *	family grows from oldn to newn children, famstatsUpdate() moves
+ *	it between histogram buckets in O(1), and offers it to a min-heap
+ *	of (at most) the k largest families in O(log k): heappos[family]
+ *	says where in the heap (if anywhere) it already is, so growing a
+ *	family already in the heap is just an increase-key.  Since
+ *	families only ever grow, a family that has dropped out of the
+ *	heap can only come back by growing past the heap's minimum.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <set.h>
+
+#include "famcoll.h"
+#include "famstats.h"
+
+
+typedef struct		/* one heap entry: a big family */
+{
+	int	family;
+	int	n;		/* how many children it has */
+	char *	parent;		/* strdup()ed */
+} heapentry;
+
+struct famstats_s
+{
+	int	    k;		/* how many families to keep in the heap */
+	heapentry * heap;	/* min-heap on n, of at most k entries */
+	int	    nheap;
+	int *	    heappos;	/* family -> heap slot+1, or 0 */
+	int	    poscap;
+	int *	    hist;	/* n -> how many families have n children */
+	int	    histcap;
+	int	    maxn;	/* biggest n with a non-zero hist[n] */
+	int	    nfamilies;
+	long	    npairs;
+};
+
+
+/*
+ * famstats s = famstatsCreate( k );
+ *	Create empty family statistics, keeping the k largest families.
+ */
+famstats famstatsCreate( int k )
+{
+	assert( k > 0 );
+	famstats s = (famstats) calloc( 1, sizeof(struct famstats_s) );
+	assert( s != NULL );
+	s->k = k;
+	s->heap = (heapentry *) malloc( k * sizeof(heapentry) );
+	assert( s->heap != NULL );
+	return s;
+}
+
+
+/*
+ * famstatsFree( s );
+ *	Free s.
+ */
+void famstatsFree( famstats s )
+{
+	int i;
+	for( i = 0; i < s->nheap; i++ )
+	{
+		free( s->heap[i].parent );
+	}
+	free( (void *)s->heap );
+	free( (void *)s->heappos );
+	free( (void *)s->hist );
+	free( (void *)s );
+}
+
+
+/*
+ * int *a = growto( a, &cap, n );
+ *	Make sure a (with cap elements) has at least n elements, zeroing
+ *	any new ones, and return it.
+ */
+static int *growto( int *a, int *cap, int n )
+{
+	if( n > *cap )
+	{
+		int newcap = *cap == 0 ? 1024 : *cap;
+		while( newcap < n )
+		{
+			newcap *= 2;
+		}
+		a = (int *) realloc( a, newcap * sizeof(int) );
+		assert( a != NULL );
+		memset( a + *cap, 0, (newcap - *cap) * sizeof(int) );
+		*cap = newcap;
+	}
+	return a;
+}
+
+
+static void place( famstats s, int slot, heapentry e )
+{
+	s->heap[slot] = e;
+	s->heappos[e.family] = slot + 1;
+}
+
+
+static void siftup( famstats s, int slot )
+{
+	heapentry e = s->heap[slot];
+	while( slot > 0 && s->heap[(slot-1)/2].n > e.n )
+	{
+		place( s, slot, s->heap[(slot-1)/2] );
+		slot = (slot-1)/2;
+	}
+	place( s, slot, e );
+}
+
+
+static void siftdown( famstats s, int slot )
+{
+	heapentry e = s->heap[slot];
+	for(;;)
+	{
+		int c = 2*slot + 1;
+		if( c >= s->nheap )
+		{
+			break;
+		}
+		if( c+1 < s->nheap && s->heap[c+1].n < s->heap[c].n )
+		{
+			c++;
+		}
+		if( s->heap[c].n >= e.n )
+		{
+			break;
+		}
+		place( s, slot, s->heap[c] );
+		slot = c;
+	}
+	place( s, slot, e );
+}
+
+
+/*
+ * offer( s, family, parent, n );
+ *	family (whose parent is parent) now has n children, not fewer:
+ *	update it in, or add it to, the heap of the k biggest families.
+ */
+static void offer( famstats s, int family, char *parent, int n )
+{
+	s->heappos = growto( s->heappos, &s->poscap, family + 1 );
+	int pos = s->heappos[family];
+	if( pos > 0 )
+	{
+		s->heap[pos-1].n = n;
+		siftdown( s, pos-1 );
+		return;
+	}
+	heapentry e;
+	e.family = family;
+	e.n = n;
+	if( s->nheap < s->k )
+	{
+		e.parent = strdup( parent );
+		s->heap[s->nheap++] = e;
+		siftup( s, s->nheap-1 );
+	} else if( n > s->heap[0].n )
+	{
+		s->heappos[s->heap[0].family] = 0;
+		free( s->heap[0].parent );
+		e.parent = strdup( parent );
+		place( s, 0, e );
+		siftdown( s, 0 );
+	}
+}
+
+
+/*
+ * famstatsUpdate( s, family, parent, oldn, newn );
+ *	Record that family (whose parent is parent) has grown from oldn
+ *	(0 for a new family) to newn children.
+ */
+void famstatsUpdate( famstats s, int family, char *parent, int oldn, int newn )
+{
+	assert( 0 <= oldn && oldn < newn );
+	s->hist = growto( s->hist, &s->histcap, newn + 1 );
+	if( oldn > 0 )
+	{
+		s->hist[oldn]--;
+	} else
+	{
+		s->nfamilies++;
+	}
+	s->hist[newn]++;
+	if( newn > s->maxn )
+	{
+		s->maxn = newn;
+	}
+	s->npairs += newn - oldn;
+	offer( s, family, parent, newn );
+}
+
+
+/*
+ * famstatsEmpty( s );
+ *	Forget all of s's families.
+ */
+void famstatsEmpty( famstats s )
+{
+	int i;
+	for( i = 0; i < s->nheap; i++ )
+	{
+		free( s->heap[i].parent );
+		s->heappos[s->heap[i].family] = 0;
+	}
+	s->nheap = 0;
+	if( s->hist != NULL )
+	{
+		memset( s->hist, 0, s->histcap * sizeof(int) );
+	}
+	s->maxn = 0;
+	s->nfamilies = 0;
+	s->npairs = 0;
+}
+
+
+static int bigfirst( const void *a, const void *b )
+{
+	const famcollfamily *x = (const famcollfamily *)a;
+	const famcollfamily *y = (const famcollfamily *)b;
+	if( x->nchildren != y->nchildren )
+	{
+		return x->nchildren > y->nchildren ? -1 : 1;
+	}
+	return strcmp( x->parent, y->parent );
+}
+
+
+/*
+ * famcollstats *st = famstatsGet( s );
+ *	Return a new copy of the current statistics, in O(maxn + k log k).
+ *	The caller should famcollStatsFree() it.
+ */
+famcollstats *famstatsGet( famstats s )
+{
+	famcollstats *st = (famcollstats *) malloc( sizeof(famcollstats) );
+	assert( st != NULL );
+	st->nfamilies = s->nfamilies;
+	st->npairs = s->npairs;
+	st->maxchildren = s->maxn;
+	st->histogram = (int *) calloc( s->maxn + 1, sizeof(int) );
+	st->ntop = s->nheap;
+	st->top = (famcollfamily *) malloc( (s->nheap+1) * sizeof(famcollfamily) );
+	assert( st->histogram != NULL && st->top != NULL );
+	if( s->maxn > 0 )
+	{
+		memcpy( st->histogram, s->hist, (s->maxn + 1) * sizeof(int) );
+	}
+	int i;
+	for( i = 0; i < s->nheap; i++ )
+	{
+		st->top[i].parent = strdup( s->heap[i].parent );
+		st->top[i].nchildren = s->heap[i].n;
+	}
+	qsort( st->top, st->ntop, sizeof(famcollfamily), &bigfirst );
+	return st;
+}
@@ -0,0 +1,13 @@
+/*
+ * famstats.h: incrementally maintained statistics about the sizes
+ *	       of families: a histogram of children per family, and
+ *	       the k largest families.
+ */
+
+typedef struct famstats_s *famstats;
+
+extern famstats famstatsCreate( int k );
+extern void famstatsFree( famstats s );
+extern void famstatsUpdate( famstats s, int family, char * parent, int oldn, int newn );
+extern void famstatsEmpty( famstats s );
+extern famcollstats *famstatsGet( famstats s );
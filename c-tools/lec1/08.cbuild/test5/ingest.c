@@ -0,0 +1,310 @@
+/*
+ *   ingest.c: build a famcoll from "parent: child" lines using
+ *	       several threads.
+ *
+ *	The whole input is mapped into memory (or read into memory, if
+ *	it's a pipe), and split into one chunk per thread at newline
+ *	boundaries.  Then, in two parallel phases:
+ *
+ *	1. each thread parses the lines in its chunk, in place, and
+ *	   appends each (parent, child) pair to one of nthreads pair
+ *	   lists, chosen by hashing the parent - its "shard".
+ *	2. each thread takes one shard, and adds all that shard's pairs
+ *	   (from every chunk, in input order) to its own famcoll.
+ *
+ *	All shards have disjoint parents, so we finish by merging the
+ *	shards' famcolls pairwise, in parallel, which needs no locking
+ *	and moves whole families.  The contents, and hence the dump, are
+ *	the same as adding every pair to one famcoll one line at a time.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <set.h>
+
+#include "famcoll.h"
+#include "ingest.h"
+
+
+typedef struct		/* one parsed line, pointing into the input */
+{
+	char *parent;
+	char *child;
+} pair;
+
+typedef struct		/* a growable list of pairs */
+{
+	pair *p;
+	int   n;
+	int   cap;
+} pairlist;
+
+typedef struct worker_s	/* what each worker thread needs */
+{
+	char *	   start;	/* phase 1: our chunk of the input */
+	char *	   end;
+	int	   nshards;
+	pairlist * shard;	/* phase 1: our pairs, one list per shard */
+	int	   id;		/* phase 2: which shard we aggregate */
+	struct worker_s *all;	/* phase 2: every worker's pair lists */
+	famcoll	   f;		/* phase 2: the famcoll for shard id */
+} worker;
+
+
+/*
+ * char *data = slurp( fd, &len );
+ *	Read all of fd into a malloc()d buffer, setting len.
+ *	A read error is fatal: we mustn't build a truncated collection.
+ */
+static char *slurp( int fd, size_t *len )
+{
+	size_t cap = 1024*1024;
+	size_t n = 0;
+	char *data = (char *) malloc( cap );
+	assert( data != NULL );
+	for(;;)
+	{
+		ssize_t got = read( fd, data+n, cap-n );
+		if( got == 0 )
+		{
+			break;
+		}
+		if( got < 0 )
+		{
+			if( errno == EINTR )
+			{
+				continue;
+			}
+			perror( "ingest: read" );
+			exit(1);
+		}
+		n += got;
+		if( n == cap )
+		{
+			cap *= 2;
+			data = (char *) realloc( data, cap );
+			assert( data != NULL );
+		}
+	}
+	*len = n;
+	return data;
+}
+
+
+/*
+ * char *tok = nexttoken( &p, end );
+ *	Find the next token in [*p..end) delimited by ':' or ' ' (as
+ *	strtok( s, ": " ) would), '\0' terminate it in place, advance *p
+ *	beyond it and return it; or return NULL if there are no more.
+ */
+static char *nexttoken( char **p, char *end )
+{
+	char *s = *p;
+	while( s < end && (*s == ':' || *s == ' ') )
+	{
+		s++;
+	}
+	if( s == end )
+	{
+		*p = end;
+		return NULL;
+	}
+	char *e = s;
+	while( e < end && *e != ':' && *e != ' ' )
+	{
+		e++;
+	}
+	*p = e < end ? e+1 : end;
+	*e = '\0';
+	return s;
+}
+
+
+static int shardof( char *parent, int nshards )
+{
+	unsigned char	ch;
+	unsigned int	hh;
+	for (hh = 0; (ch = *parent++) != '\0'; hh = hh * 65599 + ch );
+	return hh % nshards;
+}
+
+
+static void addpair( pairlist *l, char *parent, char *child )
+{
+	if( l->n == l->cap )
+	{
+		l->cap = l->cap == 0 ? 1024 : l->cap * 2;
+		l->p = (pair *) realloc( l->p, l->cap * sizeof(pair) );
+		assert( l->p != NULL );
+	}
+	l->p[l->n].parent = parent;
+	l->p[l->n].child = child;
+	l->n++;
+}
+
+
+/*
+ * Phase 1: parse the lines of our chunk into per-shard pair lists.
+ */
+static void *parse_chunk( void *arg )
+{
+	worker *w = (worker *)arg;
+	char *line = w->start;
+	while( line < w->end )
+	{
+		char *nl = memchr( line, '\n', w->end - line );
+		char *eol = nl != NULL ? nl : w->end;
+		*eol = '\0';
+		char *p = line;
+		char *parent = nexttoken( &p, eol );
+		assert( parent != NULL );
+		char *child = nexttoken( &p, eol );
+		assert( child != NULL );
+		addpair( &w->shard[shardof(parent, w->nshards)], parent, child );
+		line = eol+1;
+	}
+	return NULL;
+}
+
+
+/*
+ * Phase 2: add every chunk's pairs for our shard to our famcoll.
+ */
+static void *build_shard( void *arg )
+{
+	worker *w = (worker *)arg;
+	worker *all = w->all;
+	w->f = famcollCreate();
+	int c;
+	for( c = 0; c < w->nshards; c++ )
+	{
+		pairlist *l = &all[c].shard[w->id];
+		int i;
+		for( i = 0; i < l->n; i++ )
+		{
+			famcollAddChild( w->f, l->p[i].parent, l->p[i].child );
+		}
+	}
+	return NULL;
+}
+
+
+/*
+ * famcoll f = ingestParallel( fd, nthreads );
+ *	Read all "parent: child" lines from fd, and build a famcoll
+ *	containing them, using nthreads threads.
+ */
+famcoll ingestParallel( int fd, int nthreads )
+{
+	assert( nthreads > 0 );
+
+	/* map the input, or read it all if it can't be mapped */
+	size_t len;
+	char *data = NULL;
+	bool mapped = false;
+	struct stat st;
+	if( fstat( fd, &st ) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 )
+	{
+		len = st.st_size;
+		/* private and writable: we '\0' terminate tokens in place */
+		data = mmap( NULL, len, PROT_READ|PROT_WRITE, MAP_PRIVATE,
+			     fd, 0 );
+		mapped = data != MAP_FAILED;
+
+		/* an unterminated last line would need a '\0' beyond the map */
+		if( mapped && data[len-1] != '\n' )
+		{
+			munmap( data, len );
+			mapped = false;
+			lseek( fd, 0, SEEK_SET );
+		}
+	}
+	if( ! mapped )
+	{
+		data = slurp( fd, &len );
+	}
+
+	worker *w = (worker *) calloc( nthreads, sizeof(worker) );
+	assert( w != NULL );
+	pthread_t *tid = (pthread_t *) malloc( nthreads * sizeof(pthread_t) );
+	assert( tid != NULL );
+
+	/* split into nthreads chunks, each ending just after a newline */
+	char *start = data;
+	char *end = data + len;
+	int i;
+	for( i = 0; i < nthreads; i++ )
+	{
+		char *e = i == nthreads-1 ? end : start + (end-start)/(nthreads-i);
+		if( e < end )
+		{
+			char *nl = memchr( e, '\n', end-e );
+			e = nl != NULL ? nl+1 : end;
+		}
+		w[i].start = start;
+		w[i].end = e;
+		w[i].nshards = nthreads;
+		w[i].shard = (pairlist *) calloc( nthreads, sizeof(pairlist) );
+		assert( w[i].shard != NULL );
+		w[i].id = i;
+		w[i].all = w;
+		start = e;
+	}
+
+	for( i = 0; i < nthreads; i++ )
+	{
+		pthread_create( &tid[i], NULL, &parse_chunk, &w[i] );
+	}
+	for( i = 0; i < nthreads; i++ )
+	{
+		pthread_join( tid[i], NULL );
+	}
+	for( i = 0; i < nthreads; i++ )
+	{
+		pthread_create( &tid[i], NULL, &build_shard, &w[i] );
+	}
+	for( i = 0; i < nthreads; i++ )
+	{
+		pthread_join( tid[i], NULL );
+	}
+
+	/* combine the shards */
+	famcoll *shards = (famcoll *) malloc( nthreads * sizeof(famcoll) );
+	assert( shards != NULL );
+	for( i = 0; i < nthreads; i++ )
+	{
+		shards[i] = w[i].f;
+	}
+	famcoll f = famcollMergeAll( shards, nthreads, nthreads );
+	free( (void *)shards );
+
+	for( i = 0; i < nthreads; i++ )
+	{
+		int s;
+		for( s = 0; s < nthreads; s++ )
+		{
+			free( (void *)w[i].shard[s].p );
+		}
+		free( (void *)w[i].shard );
+	}
+	free( (void *)tid );
+	free( (void *)w );
+	if( mapped )
+	{
+		munmap( data, len );
+	} else
+	{
+		free( (void *)data );
+	}
+	return f;
+}
@@ -0,0 +1,6 @@
+/*
+ *   ingest.h: build a famcoll from "parent: child" lines using
+ *	       several threads.
+ */
+
+extern famcoll ingestParallel( int fd, int nthreads );
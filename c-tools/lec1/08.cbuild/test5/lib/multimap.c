@@ -0,0 +1,580 @@
+/*
+ * multimap.c: a multimap from strings to sets of strings.
+ *
+ *	Every distinct string (key or value) is interned once: stored in
+ *	large arena blocks, numbered with a small integer id, and found
+ *	via an open addressing hash table of ids.  Each key then owns one
+ *	entry holding a growable vector of its values' ids, in insertion
+ *	order.  Adding a value to a key must check it isn't already there:
+ *	while the vector is small, that's a linear scan of a few ints; once
+ *	it has SMALLVEC values, the entry also gets its own open addressing
+ *	hash table of value ids.
+ *
+ *	So each (key, value) pair costs 4 bytes in the vector, plus
+ *	about 8 more in the per-key table for big families, plus the
+ *	value's string once overall, instead of a tree node and a strdup()
+ *	per pair.
+ *
+ * (the multimap replaces a hash whose values were sets: each set had
+ *  its own 32533-bucket array, however few members it had)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "multimap.h"
+
+
+#define	SMALLVEC	8		/* linear scan vectors this small */
+#define	ARENABLOCK	(64*1024)	/* bytes per string arena block */
+
+
+typedef struct		/* one key and its values */
+{
+	uint32_t   key;		/* the key's string id */
+	uint32_t   n;		/* number of values */
+	uint32_t   cap;		/* allocated size of v */
+	uint32_t   idxcap;	/* size of idx: 0 or a power of 2 */
+	uint32_t * v;		/* the value ids, in insertion order */
+	uint32_t * idx;		/* open addressing table of value id+1s */
+} entry;
+
+struct multimap_s
+{
+	/* the intern pool */
+	char **	   name;	/* id -> string */
+	uint32_t * hashof;	/* id -> hash of string */
+	int *	   entryof;	/* id -> index of key's entry, or -1 */
+	uint32_t   nnames;
+	uint32_t   namecap;
+	uint32_t * table;	/* open addressing table of id+1s */
+	uint32_t   tablecap;	/* a power of 2 */
+	char *	   arena;	/* current arena block */
+	int	   arenaleft;
+	char **	   blocks;	/* all arena blocks, to free them */
+	int	   nblocks;
+	int	   blockcap;
+
+	/* the keys */
+	entry *	   entries;
+	int	   nentries;
+	int	   entrycap;
+};
+
+
+static uint32_t strhash( char *s )
+{
+	unsigned char ch;
+	uint32_t h = 2166136261u;
+	while( (ch = *s++) != '\0' )
+	{
+		h ^= ch;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+
+/* mix an id into a table slot */
+static uint32_t idhash( uint32_t id )
+{
+	id ^= id >> 16;
+	id *= 0x7feb352d;
+	id ^= id >> 15;
+	return id;
+}
+
+
+/*
+ * multimap m = mmCreate();
+ *	Create an empty multimap.
+ */
+multimap mmCreate( void )
+{
+	multimap m = (multimap) calloc( 1, sizeof(struct multimap_s) );
+	assert( m != NULL );
+	m->namecap = 256;
+	m->name = (char **) malloc( m->namecap * sizeof(char *) );
+	m->hashof = (uint32_t *) malloc( m->namecap * sizeof(uint32_t) );
+	m->entryof = (int *) malloc( m->namecap * sizeof(int) );
+	m->tablecap = 512;
+	m->table = (uint32_t *) calloc( m->tablecap, sizeof(uint32_t) );
+	m->entrycap = 64;
+	m->entries = (entry *) malloc( m->entrycap * sizeof(entry) );
+	assert( m->name && m->hashof && m->entryof && m->table && m->entries );
+	return m;
+}
+
+
+/*
+ * mmFree( m );
+ *	Free multimap m.
+ */
+void mmFree( multimap m )
+{
+	int i;
+	for( i = 0; i < m->nentries; i++ )
+	{
+		free( (void *)m->entries[i].v );
+		free( (void *)m->entries[i].idx );
+	}
+	for( i = 0; i < m->nblocks; i++ )
+	{
+		free( (void *)m->blocks[i] );
+	}
+	free( (void *)m->blocks );
+	free( (void *)m->entries );
+	free( (void *)m->table );
+	free( (void *)m->entryof );
+	free( (void *)m->hashof );
+	free( (void *)m->name );
+	free( (void *)m );
+}
+
+
+/*
+ * char *copy = arenacopy( m, s, len );
+ *	Copy s (of length len) into m's string arena.
+ */
+static char *arenacopy( multimap m, char *s, int len )
+{
+	if( len + 1 > m->arenaleft )
+	{
+		int size = len + 1 > ARENABLOCK ? len + 1 : ARENABLOCK;
+		if( m->nblocks == m->blockcap )
+		{
+			m->blockcap = m->blockcap == 0 ? 16 : m->blockcap * 2;
+			m->blocks = (char **) realloc( m->blocks,
+						m->blockcap * sizeof(char *) );
+			assert( m->blocks != NULL );
+		}
+		m->arena = (char *) malloc( size );
+		assert( m->arena != NULL );
+		m->blocks[m->nblocks++] = m->arena;
+		m->arenaleft = size;
+	}
+	char *copy = m->arena;
+	memcpy( copy, s, len + 1 );
+	m->arena += len + 1;
+	m->arenaleft -= len + 1;
+	return copy;
+}
+
+
+/*
+ * int id = findname( m, s, h );
+ *	Return the id of string s (whose hash is h), or -1.
+ */
+static int findname( multimap m, char *s, uint32_t h )
+{
+	uint32_t mask = m->tablecap - 1;
+	uint32_t i;
+	for( i = h & mask; m->table[i] != 0; i = (i+1) & mask )
+	{
+		uint32_t id = m->table[i] - 1;
+		if( m->hashof[id] == h && strcmp( m->name[id], s ) == 0 )
+		{
+			return id;
+		}
+	}
+	return -1;
+}
+
+
+/*
+ * growtable( m );
+ *	Double the size of m's intern table, rehashing every name.
+ */
+static void growtable( multimap m )
+{
+	free( (void *)m->table );
+	m->tablecap *= 2;
+	m->table = (uint32_t *) calloc( m->tablecap, sizeof(uint32_t) );
+	assert( m->table != NULL );
+	uint32_t mask = m->tablecap - 1;
+	uint32_t id;
+	for( id = 0; id < m->nnames; id++ )
+	{
+		uint32_t i;
+		for( i = m->hashof[id] & mask; m->table[i] != 0; i = (i+1) & mask );
+		m->table[i] = id + 1;
+	}
+}
+
+
+/*
+ * uint32_t id = intern( m, s );
+ *	Return the id of string s, adding it to m's pool if it's new.
+ */
+static uint32_t intern( multimap m, char *s )
+{
+	uint32_t h = strhash( s );
+	int found = findname( m, s, h );
+	if( found >= 0 )
+	{
+		return found;
+	}
+	if( m->nnames == m->namecap )
+	{
+		m->namecap *= 2;
+		m->name = (char **) realloc( m->name, m->namecap * sizeof(char *) );
+		m->hashof = (uint32_t *) realloc( m->hashof,
+					m->namecap * sizeof(uint32_t) );
+		m->entryof = (int *) realloc( m->entryof, m->namecap * sizeof(int) );
+		assert( m->name && m->hashof && m->entryof );
+	}
+	uint32_t id = m->nnames++;
+	m->name[id] = arenacopy( m, s, strlen(s) );
+	m->hashof[id] = h;
+	m->entryof[id] = -1;
+	if( m->nnames * 2 > m->tablecap )
+	{
+		growtable( m );		/* rehashes the new name too */
+	} else
+	{
+		uint32_t mask = m->tablecap - 1;
+		uint32_t i;
+		for( i = h & mask; m->table[i] != 0; i = (i+1) & mask );
+		m->table[i] = id + 1;
+	}
+	return id;
+}
+
+
+/*
+ * entry *e = findentry( m, key );
+ *	Return key's entry, or NULL if key isn't a key of m.
+ */
+static entry *findentry( multimap m, char *key )
+{
+	int id = findname( m, key, strhash(key) );
+	if( id < 0 || m->entryof[id] < 0 )
+	{
+		return NULL;
+	}
+	return &m->entries[m->entryof[id]];
+}
+
+
+/*
+ * idxinsert( e, v );
+ *	Insert value id v into e's value table.
+ *	Precondition: e->idx has room
+ */
+static void idxinsert( entry *e, uint32_t v )
+{
+	uint32_t mask = e->idxcap - 1;
+	uint32_t i;
+	for( i = idhash(v) & mask; e->idx[i] != 0; i = (i+1) & mask );
+	e->idx[i] = v + 1;
+}
+
+
+/*
+ * buildidx( e, cap );
+ *	(Re)build e's value table with cap slots.
+ */
+static void buildidx( entry *e, uint32_t cap )
+{
+	free( (void *)e->idx );
+	e->idxcap = cap;
+	e->idx = (uint32_t *) calloc( cap, sizeof(uint32_t) );
+	assert( e->idx != NULL );
+	uint32_t i;
+	for( i = 0; i < e->n; i++ )
+	{
+		idxinsert( e, e->v[i] );
+	}
+}
+
+
+/*
+ * bool in = entryhas( e, v );
+ *	Does entry e contain value id v?
+ */
+static bool entryhas( entry *e, uint32_t v )
+{
+	if( e->idx == NULL )
+	{
+		uint32_t i;
+		for( i = 0; i < e->n; i++ )
+		{
+			if( e->v[i] == v )
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+	uint32_t mask = e->idxcap - 1;
+	uint32_t i;
+	for( i = idhash(v) & mask; e->idx[i] != 0; i = (i+1) & mask )
+	{
+		if( e->idx[i] == v + 1 )
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+
+/*
+ * entrypush( e, v );
+ *	Append value id v to entry e.
+ *	Precondition: v is not already in e
+ */
+static void entrypush( entry *e, uint32_t v )
+{
+	if( e->n == e->cap )
+	{
+		e->cap = e->cap == 0 ? 2 : e->cap * 2;
+		e->v = (uint32_t *) realloc( e->v, e->cap * sizeof(uint32_t) );
+		assert( e->v != NULL );
+	}
+	e->v[e->n++] = v;
+	if( e->idx != NULL )
+	{
+		if( e->n * 2 > e->idxcap )
+		{
+			buildidx( e, e->idxcap * 2 );
+		} else
+		{
+			idxinsert( e, v );
+		}
+	} else if( e->n >= SMALLVEC )
+	{
+		buildidx( e, 4 * SMALLVEC );
+	}
+}
+
+
+/*
+ * entry *e = newentry( m, keyid );
+ *	Make keyid a key of m, with no values yet.
+ */
+static entry *newentry( multimap m, uint32_t keyid )
+{
+	if( m->nentries == m->entrycap )
+	{
+		m->entrycap *= 2;
+		m->entries = (entry *) realloc( m->entries,
+					m->entrycap * sizeof(entry) );
+		assert( m->entries != NULL );
+	}
+	entry *e = &m->entries[m->nentries];
+	m->entryof[keyid] = m->nentries++;
+	e->key = keyid;
+	e->n = e->cap = e->idxcap = 0;
+	e->v = e->idx = NULL;
+	return e;
+}
+
+
+/*
+ * bool added = mmAdd( m, key, value );
+ *	Add value to key's values (making key a key if it's new).
+ *	Return true if it was added, false if it was already there.
+ */
+bool mmAdd( multimap m, char *key, char *value )
+{
+	uint32_t k = intern( m, key );
+	uint32_t v = intern( m, value );
+	entry *e = m->entryof[k] < 0 ? newentry( m, k )
+				     : &m->entries[m->entryof[k]];
+	if( entryhas( e, v ) )
+	{
+		return false;
+	}
+	entrypush( e, v );
+	return true;
+}
+
+
+/*
+ * bool in = mmHas( m, key, value );
+ *	Is value one of key's values?
+ */
+bool mmHas( multimap m, char *key, char *value )
+{
+	entry *e = findentry( m, key );
+	if( e == NULL )
+	{
+		return false;
+	}
+	int v = findname( m, value, strhash(value) );
+	return v >= 0 && entryhas( e, v );
+}
+
+
+/*
+ * bool iskey = mmIsKey( m, key );
+ *	Is key a key of m?
+ */
+bool mmIsKey( multimap m, char *key )
+{
+	return findentry( m, key ) != NULL;
+}
+
+
+/*
+ * int n = mmNKeys( m );
+ *	How many keys does m have?
+ */
+int mmNKeys( multimap m )
+{
+	return m->nentries;
+}
+
+
+/*
+ * int n = mmNValues( m, key );
+ *	How many values does key have (0 if key isn't a key)?
+ */
+int mmNValues( multimap m, char *key )
+{
+	entry *e = findentry( m, key );
+	return e == NULL ? 0 : e->n;
+}
+
+
+/*
+ * int index = mmKeyIndex( m, key );
+ *	Return key's index: keys are numbered 0, 1, 2.. in the order they
+ *	were first added, so callers can keep per-key data in a flat
+ *	array.  Return -1 if key isn't a key.
+ */
+int mmKeyIndex( multimap m, char *key )
+{
+	int id = findname( m, key, strhash(key) );
+	return id < 0 ? -1 : m->entryof[id];
+}
+
+
+/*
+ * int n = mmNValuesAt( m, index );
+ *	How many values does the key with the given index have?
+ *	Precondition: 0 <= index < mmNKeys(m)
+ */
+int mmNValuesAt( multimap m, int index )
+{
+	assert( index >= 0 && index < m->nentries );
+	return m->entries[index].n;
+}
+
+
+/*
+ * bool found = mmForeachValue( m, key, cb, arg );
+ *	If key is a key of m, call cb( value, arg ) for each of its
+ *	values, in the order they were added, and return true;
+ *	otherwise return false.  The value strings belong to m.
+ */
+bool mmForeachValue( multimap m, char *key, mmvaluecb cb, void *arg )
+{
+	entry *e = findentry( m, key );
+	if( e == NULL )
+	{
+		return false;
+	}
+	uint32_t i;
+	for( i = 0; i < e->n; i++ )
+	{
+		(*cb)( m->name[e->v[i]], arg );
+	}
+	return true;
+}
+
+
+/*
+ * mmForeachKey( m, cb, arg );
+ *	Call cb( key, arg ) for each key of m, in the order they were
+ *	first added.  The key strings belong to m.
+ */
+void mmForeachKey( multimap m, mmkeycb cb, void *arg )
+{
+	int i;
+	for( i = 0; i < m->nentries; i++ )
+	{
+		(*cb)( m->name[m->entries[i].key], arg );
+	}
+}
+
+
+/*
+ * mmMerge( dst, src, cb, arg );
+ *	Merge all of src's keys, and their values, into dst, leaving src
+ *	empty.  Each of src's distinct strings is interned into dst once,
+ *	which copies it into dst's arena unless dst already has it.  Then
+ *	each key that's new to dst has its value vector moved across (not
+ *	copied), with its ids renumbered in place, while each key that
+ *	both have gets the union: src's values are added to dst's vector,
+ *	skipping those already there.  New keys keep their order, after
+ *	dst's, so if no key is in both, src's key index i becomes dst's
+ *	index mmNKeys(dst)+i.
+ *	Unless cb is NULL, cb( key, index, oldn, newn, arg ) is called
+ *	after each of src's keys is merged, with key's index in dst and
+ *	how many values it had there before (0 if it's new) and after.
+ */
+void mmMerge( multimap dst, multimap src, mmmergecb cb, void *arg )
+{
+	uint32_t *newid = (uint32_t *) malloc( (src->nnames+1) * sizeof(uint32_t) );
+	assert( newid != NULL );
+	uint32_t id;
+	for( id = 0; id < src->nnames; id++ )
+	{
+		newid[id] = intern( dst, src->name[id] );
+	}
+
+	int i;
+	for( i = 0; i < src->nentries; i++ )
+	{
+		entry *s = &src->entries[i];
+		uint32_t k = newid[s->key];
+		uint32_t oldn = 0;
+		entry *e;
+		uint32_t j;
+		if( dst->entryof[k] < 0 )	/* a new key: steal the vector */
+		{
+			e = newentry( dst, k );
+			e->n = s->n;
+			e->cap = s->cap;
+			e->v = s->v;
+			for( j = 0; j < e->n; j++ )
+			{
+				e->v[j] = newid[e->v[j]];
+			}
+			if( s->idx != NULL )
+			{
+				buildidx( e, s->idxcap );
+			}
+		} else				/* in both: union */
+		{
+			e = &dst->entries[dst->entryof[k]];
+			oldn = e->n;
+			for( j = 0; j < s->n; j++ )
+			{
+				uint32_t v = newid[s->v[j]];
+				if( ! entryhas( e, v ) )
+				{
+					entrypush( e, v );
+				}
+			}
+			free( (void *)s->v );
+		}
+		free( (void *)s->idx );
+		if( cb != NULL )
+		{
+			(*cb)( dst->name[k], dst->entryof[k], oldn, e->n, arg );
+		}
+	}
+	free( (void *)newid );
+
+	/* empty src, keeping its (now unused) strings until it's freed */
+	memset( src->table, 0, src->tablecap * sizeof(uint32_t) );
+	src->nnames = 0;
+	src->nentries = 0;
+}
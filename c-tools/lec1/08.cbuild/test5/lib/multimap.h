@@ -0,0 +1,24 @@
+/*
+ * multimap.h: a multimap from strings to sets of strings, storing
+ *	       each key's values as one contiguous vector of interned
+ *	       string ids.
+ */
+
+typedef struct multimap_s *multimap;
+
+typedef void (*mmkeycb)( char * key, void * arg );
+typedef void (*mmvaluecb)( char * value, void * arg );
+typedef void (*mmmergecb)( char * key, int index, int oldn, int newn, void * arg );
+
+extern multimap mmCreate( void );
+extern void mmFree( multimap m );
+extern bool mmAdd( multimap m, char * key, char * value );
+extern bool mmHas( multimap m, char * key, char * value );
+extern bool mmIsKey( multimap m, char * key );
+extern int mmNKeys( multimap m );
+extern int mmNValues( multimap m, char * key );
+extern int mmKeyIndex( multimap m, char * key );
+extern int mmNValuesAt( multimap m, int index );
+extern bool mmForeachValue( multimap m, char * key, mmvaluecb cb, void * arg );
+extern void mmForeachKey( multimap m, mmkeycb cb, void * arg );
+extern void mmMerge( multimap dst, multimap src, mmmergecb cb, void * arg );
@@ -9,6 +9,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "set.h"
 
@@ -23,6 +24,7 @@ struct set_s {
 	tree *		data;
 	setprintfunc	p;
 	int		nmembers;
+	uint64_t	fingerprint;		/* sum of member hashes */
 };
 
 struct tree_s {
@@ -45,8 +47,10 @@ static void adddelop( setkey k, void * v );
 static void exclude_if_notin_cb( setkey k, void * arg );
 static void diff_cb( setkey k, void * arg );
 static void dump_foreachcb( setkey k, void * arg );
+static void equals_cb( setkey k, void * arg );
 static tree talloc( setkey k );
 static int shash( char * str );
+static uint64_t memberhash( char * str );
 static tree symop( set s, setkey k, ops op );
 static void foreach_tree( tree t, setforeachcb f, void * arg );
 static tree copy_tree( tree t );
@@ -63,6 +67,7 @@ set setCreate( setprintfunc p )
 	s->data = (tree *) malloc( NHASH*sizeof(tree) );
 	s->p = p;
 	s->nmembers = 0;
+	s->fingerprint = 0;
 
 	int   i;
 	for( i = 0; i < NHASH; i++ )
@@ -86,6 +91,7 @@ void setEmpty( set s )
 		s->data[i] = NULL;
 	}
 	s->nmembers = 0;
+	s->fingerprint = 0;
 }
 
 
@@ -101,6 +107,7 @@ set setCopy( set s )
 	result->data = (tree *) malloc( NHASH*sizeof(tree) );
 	result->p = s->p;
 	result->nmembers = s->nmembers;
+	result->fingerprint = s->fingerprint;
 
 	for( i = 0; i < NHASH; i++ )
 	{
@@ -359,6 +366,45 @@ bool setIsEmpty( set s )
 	return s->nmembers == 0;
 }
 
+/*
+ * Set fingerprint: an order-independent 64-bit hash of the members,
+ *  maintained incrementally by add/remove, so equal sets always have
+ *  equal fingerprints (and unequal sets almost never do).
+ */
+uint64_t setFingerprint( set s )
+{
+	return s->fingerprint;
+}
+
+/*
+ * Set equality: do a and b contain exactly the same members?
+ *  sizes or fingerprints that differ reject in O(1); only when
+ *  both match do we check every member of a against b.
+ */
+typedef struct { set other; bool equal; } equalsdata;
+static void equals_cb( setkey k, void *arg )
+{
+	equalsdata *d = (equalsdata *)arg;
+	if( d->equal && ! setIn( d->other, k ) )
+	{
+		d->equal = false;
+	}
+}
+bool setEquals( set a, set b )
+{
+	if( a == b )
+	{
+		return true;
+	}
+	if( a->nmembers != b->nmembers || a->fingerprint != b->fingerprint )
+	{
+		return false;
+	}
+	equalsdata data; data.other = b; data.equal = true;
+	setForeach( a, &equals_cb, (void *)&data );
+	return data.equal;
+}
+
 /*
  * Set subtraction, a -= b
  */
@@ -450,6 +496,29 @@ static int shash( char *str )
 }
 
 
+/*
+ * Calculate a well-mixed 64-bit hash of a set member, used to build
+ * the set fingerprint: FNV-1a over the bytes, then a splitmix64
+ * finalizer so that summing the member hashes stays order-independent
+ * but doesn't cancel out for similar strings.
+ */
+static uint64_t memberhash( char *str )
+{
+	unsigned char	ch;
+	uint64_t	h = 0xcbf29ce484222325ULL;
+
+	while( (ch = *str++) != '\0' )
+	{
+		h ^= ch;
+		h *= 0x100000001b3ULL;
+	}
+	h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	return h;
+}
+
+
 /*
  * Operate on the symbol table
  * Search, Define, Exclude.
@@ -469,6 +538,7 @@ static tree symop( set s, setkey k, ops op )
 				if( ! ptr->in )
 				{
 					s->nmembers++;
+					s->fingerprint += memberhash( k );
 					ptr->in = true;
 				}
 			} else if( op == Exclude )
@@ -477,6 +547,7 @@ static tree symop( set s, setkey k, ops op )
 				{
 					ptr->in = false;
 					s->nmembers--;
+					s->fingerprint -= memberhash( k );
 				}
 			} else if( ! ptr->in )
 			{
@@ -499,6 +570,7 @@ static tree symop( set s, setkey k, ops op )
 	{
 		ptr = *aptr = talloc(k);	/* Alloc new node */
 		s->nmembers++;
+		s->fingerprint += memberhash( k );
 		return ptr;
 	}
 
@@ -30,4 +30,6 @@ extern void setDiff( set a, set b );
 extern int setNMembers( set s );
 extern bool setIsEmpty( set s );
 extern void setSubtraction( set a, set b );
+extern uint64_t setFingerprint( set s );
+extern bool setEquals( set a, set b );
 extern void setDump( FILE * out, set s );
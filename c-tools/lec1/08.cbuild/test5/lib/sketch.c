@@ -0,0 +1,285 @@
+/*
+ * sketch.c: fixed-size probabilistic summaries of sets of strings:
+ *	     MinHash signatures (for Jaccard similarity estimates) and
+ *	     HyperLogLog counters (for distinct-count estimates).
+ *
+ *	     Both are built from a single 64-bit hash of each string;
+ *	     the MinHash derives its K hash functions from that by
+ *	     re-mixing it with K different seeds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "sketch.h"
+
+
+#define	HLL_M	(1<<HLL_P)
+
+
+struct minhash_s {
+	uint64_t	min[MINHASH_K];		/* min hash value per function */
+};
+
+struct hll_s {
+	unsigned char	reg[HLL_M];		/* max rank seen per register */
+};
+
+
+/* Private functions */
+
+static uint64_t strhash( char * str );
+static uint64_t mix( uint64_t h );
+
+
+/*
+ * minhash m = minhashCreate();
+ *	Create an empty MinHash signature.
+ */
+minhash minhashCreate( void )
+{
+	minhash m = (minhash) malloc( sizeof(struct minhash_s) );
+	assert( m != NULL );
+	int i;
+	for( i = 0; i < MINHASH_K; i++ )
+	{
+		m->min[i] = UINT64_MAX;
+	}
+	return m;
+}
+
+
+/*
+ * minhash m2 = minhashCopy( m );
+ *	Copy a MinHash signature.
+ */
+minhash minhashCopy( minhash m )
+{
+	minhash result = (minhash) malloc( sizeof(struct minhash_s) );
+	assert( result != NULL );
+	*result = *m;
+	return result;
+}
+
+
+/*
+ * minhashFree( m );
+ *	Free a MinHash signature.
+ */
+void minhashFree( minhash m )
+{
+	free( (void *)m );
+}
+
+
+/*
+ * minhashAdd( m, k );
+ *	Add string k to the set summarised by m.
+ */
+void minhashAdd( minhash m, char *k )
+{
+	uint64_t h = strhash( k );
+	int i;
+	for( i = 0; i < MINHASH_K; i++ )
+	{
+		uint64_t hi = mix( h + (uint64_t)(i+1) * 0x9e3779b97f4a7c15ULL );
+		if( hi < m->min[i] )
+		{
+			m->min[i] = hi;
+		}
+	}
+}
+
+
+/*
+ * minhashMerge( dst, src );
+ *	dst += src: afterwards dst is the signature of the union of both
+ *	sets, exactly as if every member of src had been added to dst.
+ */
+void minhashMerge( minhash dst, minhash src )
+{
+	int i;
+	for( i = 0; i < MINHASH_K; i++ )
+	{
+		if( src->min[i] < dst->min[i] )
+		{
+			dst->min[i] = src->min[i];
+		}
+	}
+}
+
+
+/*
+ * double j = minhashJaccard( a, b );
+ *	Estimate the Jaccard similarity of the sets summarised by a and b:
+ *	the fraction of hash functions on which their minima agree.
+ */
+double minhashJaccard( minhash a, minhash b )
+{
+	int same = 0;
+	int i;
+	for( i = 0; i < MINHASH_K; i++ )
+	{
+		if( a->min[i] == b->min[i] )
+		{
+			same++;
+		}
+	}
+	return same / (double)MINHASH_K;
+}
+
+
+/*
+ * uint64_t h = minhashBandHash( m, band, rows );
+ *	Hash the rows minima in band number band of m together, for
+ *	locality-sensitive hashing: two signatures that agree on every
+ *	row of some band land in the same bucket for that band.
+ *	Precondition: (band+1)*rows <= MINHASH_K
+ */
+uint64_t minhashBandHash( minhash m, int band, int rows )
+{
+	assert( band >= 0 && rows > 0 && (band+1)*rows <= MINHASH_K );
+	uint64_t h = (uint64_t)band;
+	int i;
+	for( i = band*rows; i < (band+1)*rows; i++ )
+	{
+		h = mix( h ^ m->min[i] );
+	}
+	return h;
+}
+
+
+/*
+ * hll h = hllCreate();
+ *	Create an empty HyperLogLog counter.
+ */
+hll hllCreate( void )
+{
+	hll h = (hll) malloc( sizeof(struct hll_s) );
+	assert( h != NULL );
+	memset( h->reg, 0, HLL_M );
+	return h;
+}
+
+
+/*
+ * hll h2 = hllCopy( h );
+ *	Copy a HyperLogLog counter.
+ */
+hll hllCopy( hll h )
+{
+	hll result = (hll) malloc( sizeof(struct hll_s) );
+	assert( result != NULL );
+	*result = *h;
+	return result;
+}
+
+
+/*
+ * hllFree( h );
+ *	Free a HyperLogLog counter.
+ */
+void hllFree( hll h )
+{
+	free( (void *)h );
+}
+
+
+/*
+ * hllAdd( h, k );
+ *	Add string k to the multiset counted by h: the top HLL_P bits
+ *	of the hash pick a register, which remembers the longest run of
+ *	leading zeroes (plus one) seen in the remaining bits.
+ */
+void hllAdd( hll h, char *k )
+{
+	uint64_t x = strhash( k );
+	int r = x >> (64 - HLL_P);
+	uint64_t rest = (x << HLL_P) | (1ULL << (HLL_P-1));
+	unsigned char rank = __builtin_clzll( rest ) + 1;
+	if( rank > h->reg[r] )
+	{
+		h->reg[r] = rank;
+	}
+}
+
+
+/*
+ * hllMerge( dst, src );
+ *	dst += src: afterwards dst counts the union of both multisets.
+ */
+void hllMerge( hll dst, hll src )
+{
+	int i;
+	for( i = 0; i < HLL_M; i++ )
+	{
+		if( src->reg[i] > dst->reg[i] )
+		{
+			dst->reg[i] = src->reg[i];
+		}
+	}
+}
+
+
+/*
+ * double n = hllEstimate( h );
+ *	Estimate the number of distinct strings added to h, using
+ *	linear counting for small cardinalities.
+ */
+double hllEstimate( hll h )
+{
+	double sum = 0.0;
+	int zeroes = 0;
+	int i;
+	for( i = 0; i < HLL_M; i++ )
+	{
+		sum += ldexp( 1.0, -h->reg[i] );
+		if( h->reg[i] == 0 )
+		{
+			zeroes++;
+		}
+	}
+	double m = HLL_M;
+	double alpha = 0.7213 / (1.0 + 1.079/m);
+	double e = alpha * m * m / sum;
+	if( e <= 2.5 * m && zeroes > 0 )
+	{
+		e = m * log( m / zeroes );
+	}
+	return e;
+}
+
+
+/*
+ * Calculate a 64-bit hash of a string: FNV-1a over the bytes,
+ * then mixed so that every output bit depends on every input bit.
+ */
+static uint64_t strhash( char *str )
+{
+	unsigned char	ch;
+	uint64_t	h = 0xcbf29ce484222325ULL;
+
+	while( (ch = *str++) != '\0' )
+	{
+		h ^= ch;
+		h *= 0x100000001b3ULL;
+	}
+	return mix( h );
+}
+
+
+/*
+ * The splitmix64 finalizer.
+ */
+static uint64_t mix( uint64_t h )
+{
+	h ^= h >> 30; h *= 0xbf58476d1ce4e5b9ULL;
+	h ^= h >> 27; h *= 0x94d049bb133111ebULL;
+	h ^= h >> 31;
+	return h;
+}
@@ -0,0 +1,33 @@
+/*
+ * sketch.h: fixed-size probabilistic summaries of sets of strings..
+ *
+ *	a minhash is a MinHash signature: from two signatures we can
+ *	estimate the Jaccard similarity |A&B|/|A+B| of the original sets.
+ *
+ *	an hll is a HyperLogLog counter: it estimates the number of
+ *	distinct strings added to it, and two of them can be merged to
+ *	estimate the distinct count of the union.
+ *
+ *	Both cost O(1) space no matter how many strings are added.
+ */
+
+#define	MINHASH_K	64		/* number of hash functions */
+#define	HLL_P		10		/* 2^HLL_P registers */
+
+typedef struct minhash_s *minhash;
+typedef struct hll_s *hll;
+
+extern minhash minhashCreate( void );
+extern minhash minhashCopy( minhash m );
+extern void minhashFree( minhash m );
+extern void minhashAdd( minhash m, char * k );
+extern void minhashMerge( minhash dst, minhash src );
+extern double minhashJaccard( minhash a, minhash b );
+extern uint64_t minhashBandHash( minhash m, int band, int rows );
+
+extern hll hllCreate( void );
+extern hll hllCopy( hll h );
+extern void hllFree( hll h );
+extern void hllAdd( hll h, char * k );
+extern void hllMerge( hll dst, hll src );
+extern double hllEstimate( hll h );
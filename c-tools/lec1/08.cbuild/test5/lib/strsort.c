@@ -0,0 +1,104 @@
+/*
+ * strsort.c: sort an array of strings into strcmp() order,
+ *	      by MSD (most significant digit first) radix sort.
+ *
+ *	At depth d, we distribute the strings into 256 buckets by their
+ *	d'th character (after first copying those characters into a
+ *	separate array, so that counting and distributing them scan
+ *	memory sequentially instead of chasing every string pointer
+ *	twice), then sort each bucket at depth d+1.  Strings that end
+ *	at depth d are all equal, so need no further sorting.  Small
+ *	buckets are finished off with an insertion sort.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "strsort.h"
+
+
+#define	SMALL	32		/* insertion sort buckets this small */
+
+
+/*
+ * insertion sort a[0..n-1], all of which share their first d chars
+ */
+static void inssort( char **a, int n, int d )
+{
+	int i, j;
+	for( i = 1; i < n; i++ )
+	{
+		char *s = a[i];
+		for( j = i; j > 0 && strcmp( a[j-1]+d, s+d ) > 0; j-- )
+		{
+			a[j] = a[j-1];
+		}
+		a[j] = s;
+	}
+}
+
+
+/*
+ * radix sort a[0..n-1], all of which share their first d chars,
+ * using tmp[0..n-1] and ch[0..n-1] as workspace
+ */
+static void msd( char **a, int n, int d, char **tmp, unsigned char *ch )
+{
+	if( n < SMALL )
+	{
+		inssort( a, n, d );
+		return;
+	}
+
+	int count[257];
+	memset( count, 0, sizeof(count) );
+	int i;
+	for( i = 0; i < n; i++ )
+	{
+		ch[i] = (unsigned char)a[i][d];
+		count[ch[i]+1]++;
+	}
+	for( i = 1; i < 257; i++ )
+	{
+		count[i] += count[i-1];
+	}
+	int start[256];
+	memcpy( start, count, sizeof(start) );
+	for( i = 0; i < n; i++ )
+	{
+		tmp[count[ch[i]]++] = a[i];
+	}
+	memcpy( a, tmp, n * sizeof(char *) );
+
+	/* bucket 0 holds strings that have ended: they're all equal */
+	int c;
+	for( c = 1; c < 256; c++ )
+	{
+		int size = count[c] - start[c];
+		if( size > 1 )
+		{
+			msd( a + start[c], size, d+1, tmp, ch );
+		}
+	}
+}
+
+
+/*
+ * strSort( a, n );
+ *	sort the n strings in a into strcmp() order.
+ */
+void strSort( char **a, int n )
+{
+	if( n < 2 )
+	{
+		return;
+	}
+	char **tmp = (char **) malloc( n * sizeof(char *) );
+	unsigned char *ch = (unsigned char *) malloc( n );
+	assert( tmp != NULL && ch != NULL );
+	msd( a, n, 0, tmp, ch );
+	free( (void *)tmp );
+	free( (void *)ch );
+}
@@ -0,0 +1,6 @@
+/*
+ * strsort.h: sort an array of strings into strcmp() order,
+ *	      by MSD radix sort.
+ */
+
+extern void strSort( char ** a, int n );
@@ -0,0 +1,117 @@
+/*
+ * testmultimap.c: test program for the multimap module.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "testutils.h"
+#include "multimap.h"
+
+
+/* collect values into a comma-separated string */
+static void catvalue( char *value, void *arg )
+{
+	char *buf = (char *)arg;
+	strcat( buf, value );
+	strcat( buf, "," );
+}
+
+
+static void countkey( char *key, void *arg )
+{
+	(*(int *)arg)++;
+}
+
+
+/* record each merged key as "key:index:oldn:newn," */
+static void mergedkey( char *key, int index, int oldn, int newn, void *arg )
+{
+	sprintf( (char *)arg + strlen((char *)arg), "%s:%d:%d:%d,",
+		 key, index, oldn, newn );
+}
+
+
+int main( int argc, char **argv )
+{
+	multimap m = mmCreate();
+	testcond( mmAdd( m, "mum", "alice" ), "add mum:alice" );
+	testcond( mmAdd( m, "mum", "bob" ), "add mum:bob" );
+	testcond( ! mmAdd( m, "mum", "alice" ), "re-add mum:alice" );
+	testcond( mmAdd( m, "dad", "alice" ), "add dad:alice" );
+	testint( mmNKeys( m ), 2, "2 keys" );
+	testint( mmNValues( m, "mum" ), 2, "mum has 2 values" );
+	testint( mmNValues( m, "alice" ), 0, "alice has no values" );
+	testcond( mmIsKey( m, "dad" ), "dad is a key" );
+	testcond( ! mmIsKey( m, "alice" ), "alice is not a key" );
+	testcond( mmHas( m, "dad", "alice" ), "dad has alice" );
+	testcond( ! mmHas( m, "dad", "bob" ), "dad hasn't bob" );
+	testcond( ! mmHas( m, "nobody", "bob" ), "nobody hasn't bob" );
+
+	char buf[1024] = "";
+	testcond( mmForeachValue( m, "mum", &catvalue, buf ), "foreach mum" );
+	testcond( strcmp( buf, "alice,bob," ) == 0, "mum's values in order" );
+	testcond( ! mmForeachValue( m, "alice", &catvalue, buf ), "foreach alice" );
+
+	/* big enough to switch each key over to its own table */
+	int i;
+	bool ok = true;
+	for( i = 0; i < 5000; i++ )
+	{
+		char v[32];
+		sprintf( v, "kid%d", i );
+		ok = ok && mmAdd( m, "big", v ) && ! mmAdd( m, "big", v );
+	}
+	testcond( ok, "add 5000 distinct values to big" );
+	testint( mmNValues( m, "big" ), 5000, "big has 5000 values" );
+	testcond( mmHas( m, "big", "kid4999" ), "big has kid4999" );
+	testcond( ! mmHas( m, "big", "kid5000" ), "big hasn't kid5000" );
+
+	multimap m2 = mmCreate();
+	mmAdd( m2, "aunt", "bob" );
+	mmAdd( m2, "aunt", "carol" );
+	for( i = 0; i < 100; i++ )
+	{
+		char v[32];
+		sprintf( v, "kid%d", i );
+		mmAdd( m2, "uncle", v );
+	}
+	int before = mmNKeys( m );
+	testint( mmKeyIndex( m2, "uncle" ), 1, "uncle is m2's key 1" );
+	mmMerge( m, m2, NULL, NULL );
+	testint( mmKeyIndex( m, "uncle" ), before+1, "uncle's index after move" );
+	testint( mmNValuesAt( m, before+1 ), 100, "uncle has 100 values" );
+	testint( mmKeyIndex( m, "kid7" ), -1, "kid7 is not a key" );
+	testint( mmNKeys( m2 ), 0, "moved-from map is empty" );
+	testint( mmNKeys( m ), 5, "moved-to map has 5 keys" );
+	testcond( mmHas( m, "aunt", "carol" ), "aunt has carol after move" );
+	testcond( mmHas( m, "uncle", "kid99" ), "uncle has kid99 after move" );
+	testcond( ! mmAdd( m, "uncle", "kid42" ), "uncle's table survived move" );
+	mmAdd( m2, "x", "y" );
+	testcond( mmHas( m2, "x", "y" ), "moved-from map still usable" );
+
+	/* merging overlapping keys takes the union */
+	mmAdd( m2, "mum", "bob" );
+	mmAdd( m2, "mum", "zed" );
+	mmAdd( m2, "big", "kid0" );
+	mmAdd( m2, "big", "kid5000" );
+	buf[0] = '\0';
+	mmMerge( m, m2, &mergedkey, buf );
+	testcond( strcmp( buf, "x:5:0:1,mum:0:2:3,big:2:5000:5001," ) == 0,
+		"merge callback sees each key's old and new sizes" );
+	testint( mmNKeys( m ), 6, "merged map has 6 keys" );
+	buf[0] = '\0';
+	mmForeachValue( m, "mum", &catvalue, buf );
+	testcond( strcmp( buf, "alice,bob,zed," ) == 0, "mum's merged values" );
+	testcond( mmHas( m, "big", "kid5000" ), "big has kid5000 after merge" );
+
+	int nkeys = 0;
+	mmForeachKey( m, &countkey, &nkeys );
+	testint( nkeys, 6, "foreach key visits 6 keys" );
+
+	mmFree( m2 );
+	mmFree( m );
+	return 0;
+}
@@ -8,7 +8,9 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
+#include "testutils.h"
 #include "set.h"
 
 
@@ -108,6 +110,30 @@ int main( int argc, char **argv )
 	setForeach( s, &each_cb, stdout );
 	printf( "}\n" );
 
+	printf( "\nequality and fingerprint tests:\n" );
+	set t = setCreate( myPrint );
+	setAdd( t, "aardvark" );
+	setAdd( t, "one" );
+	setAdd( t, "mo" );
+	testcond( ! setEquals( s, t ), "s != t (t missing 2 members)" );
+	setAdd( t, "miny" );
+	setAdd( t, "eeny" );
+	testcond( setEquals( s, t ), "s == t (same members, different order)" );
+	testcond( setFingerprint( s ) == setFingerprint( t ),
+		"fingerprint(s) == fingerprint(t)" );
+
+	setAdd( t, "zebra" );
+	testcond( ! setEquals( s, t ), "s != t after adding zebra to t" );
+	setRemove( t, "zebra" );
+	testcond( setEquals( s, t ), "s == t after removing zebra from t" );
+
+	set c = setCopy( s );
+	testcond( setEquals( s, c ), "s == copy(s)" );
+	setEmpty( c );
+	testcond( setFingerprint( c ) == 0, "fingerprint(empty) == 0" );
+	setFree( c );
+	setFree( t );
+
 	printf( "\nfree the set\n" );
 	setFree( s );
 
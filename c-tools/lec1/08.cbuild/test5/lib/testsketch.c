@@ -0,0 +1,99 @@
+/*
+ * testsketch.c: test program for the MinHash and HyperLogLog sketches.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+
+#include "testutils.h"
+#include "sketch.h"
+
+
+/*
+ * bool ok = within( got, expected, tolerance );
+ *	is got within (relative) tolerance of expected?
+ */
+static bool within( double got, double expected, double tolerance )
+{
+	return fabs( got - expected ) <= tolerance * expected;
+}
+
+
+int main( int argc, char **argv )
+{
+	char msg[1024];
+	char k[100];
+	int i;
+
+	/* a = 0..999, b = 500..1499: Jaccard = 500/1500 = 1/3 */
+	minhash a = minhashCreate();
+	minhash b = minhashCreate();
+	for( i = 0; i < 1000; i++ )
+	{
+		sprintf( k, "name%d", i );
+		minhashAdd( a, k );
+		sprintf( k, "name%d", i+500 );
+		minhashAdd( b, k );
+	}
+	testcond( minhashJaccard( a, a ) == 1.0, "jaccard(a,a) == 1" );
+	double j = minhashJaccard( a, b );
+	sprintf( msg, "jaccard(a,b) ~ 0.33 (got %.2f)", j );
+	testcond( j > 0.15 && j < 0.55, msg );
+
+	minhash c = minhashCopy( a );
+	testcond( minhashBandHash( a, 3, 4 ) == minhashBandHash( c, 3, 4 ),
+		"band hash of copy is the same" );
+	minhashAdd( c, "name0" );
+	testcond( minhashJaccard( a, c ) == 1.0,
+		"adding an existing member changes nothing" );
+	minhashFree( c );
+
+	/* a+b merged == a and b's members added one by one */
+	minhash ab = minhashCopy( a );
+	minhashMerge( ab, b );
+	c = minhashCopy( a );
+	for( i = 500; i < 1500; i++ )
+	{
+		sprintf( k, "name%d", i );
+		minhashAdd( c, k );
+	}
+	testcond( minhashJaccard( ab, c ) == 1.0, "merge(a,b) == union(a,b)" );
+	minhashFree( c );
+	minhashFree( ab );
+	minhashFree( a );
+	minhashFree( b );
+
+	hll h = hllCreate();
+	testcond( hllEstimate( h ) == 0.0, "estimate(empty hll) == 0" );
+	for( i = 0; i < 10000; i++ )
+	{
+		sprintf( k, "name%d", i );
+		hllAdd( h, k );
+		hllAdd( h, k );		/* duplicates don't count */
+	}
+	double e = hllEstimate( h );
+	sprintf( msg, "estimate(10000 distinct) within 10%% (got %.0f)", e );
+	testcond( within( e, 10000, 0.1 ), msg );
+
+	hll h2 = hllCreate();
+	for( i = 5000; i < 20000; i++ )
+	{
+		sprintf( k, "name%d", i );
+		hllAdd( h2, k );
+	}
+	hll u = hllCopy( h );
+	hllMerge( u, h2 );
+	e = hllEstimate( u );
+	sprintf( msg, "estimate(union, 20000 distinct) within 10%% (got %.0f)", e );
+	testcond( within( e, 20000, 0.1 ), msg );
+
+	hllFree( u );
+	hllFree( h2 );
+	hllFree( h );
+
+	return 0;
+}
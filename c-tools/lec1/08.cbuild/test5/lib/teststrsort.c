@@ -0,0 +1,75 @@
+/*
+ * teststrsort.c: test program for the string radix sort.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "testutils.h"
+#include "strsort.h"
+
+
+static int cmp( const void *a, const void *b )
+{
+	return strcmp( *(char **)a, *(char **)b );
+}
+
+
+/*
+ * bool same = sortsagree( a, n );
+ *	does strSort() sort a[0..n-1] the same way qsort+strcmp does?
+ */
+static bool sortsagree( char **a, int n )
+{
+	char **b = (char **) malloc( n * sizeof(char *) );
+	memcpy( b, a, n * sizeof(char *) );
+	strSort( a, n );
+	qsort( b, n, sizeof(char *), &cmp );
+	bool same = true;
+	int i;
+	for( i = 0; i < n; i++ )
+	{
+		if( strcmp( a[i], b[i] ) != 0 )
+		{
+			same = false;
+		}
+	}
+	free( (void *)b );
+	return same;
+}
+
+
+int main( int argc, char **argv )
+{
+	char *small[] = { "one", "two", "three", "", "on", "one", "\xff" };
+	testcond( sortsagree( small, 7 ), "sort 7 strings" );
+	teststring( small[0], "", "empty string first" );
+	teststring( small[6], "\xff", "high chars last" );
+
+	int n = 20000;
+	char **big = (char **) malloc( n * sizeof(char *) );
+	int i;
+	srand( 42 );
+	for( i = 0; i < n; i++ )
+	{
+		char s[100];
+		int len = rand() % 12;
+		int j;
+		for( j = 0; j < len; j++ )
+		{
+			s[j] = "abcxyz"[rand() % 6];
+		}
+		s[len] = '\0';
+		big[i] = strdup( s );
+	}
+	testcond( sortsagree( big, n ), "sort 20000 random strings" );
+	for( i = 0; i < n; i++ )
+	{
+		free( big[i] );
+	}
+	free( (void *)big );
+
+	return 0;
+}
@@ -0,0 +1,167 @@
+/*
+ *   linereader.c: read lines of any length from a file descriptor.
+ *
+ *	We read(2) the input in large blocks into one buffer, and find
+ *	each newline with memchr(), which scans at memory bandwidth.
+ *	Each line is handed out as a view (pointer and length) directly
+ *	into the buffer: the newline is overwritten by a '\0', so the
+ *	view is also a normal C string, but nothing is copied.  A line
+ *	that runs off the end of the buffer is moved to the front before
+ *	reading the next block, and the buffer doubles whenever a single
+ *	line won't fit, so lines may be of any length.  A read error
+ *	ends the input like EOF does, but is remembered for lrError().
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "linereader.h"
+
+
+#define BLOCKSIZE (1024*1024)
+
+
+struct linereader_s
+{
+	int	fd;
+	char *	buf;		/* buffer of size+1 bytes (room for a '\0') */
+	int	size;
+	int	pos;		/* start of the next unread line */
+	int	end;		/* end of valid data */
+	bool	eof;		/* has read() returned 0 (or failed)? */
+	int	err;		/* errno of a failed read(), else 0 */
+};
+
+
+/*
+ * linereader r = lrCreate( fd );
+ *	Create a line reader reading from file descriptor fd.
+ */
+linereader lrCreate( int fd )
+{
+	linereader r = (linereader) malloc( sizeof(struct linereader_s) );
+	assert( r != NULL );
+	r->fd = fd;
+	r->size = BLOCKSIZE;
+	r->buf = (char *) malloc( r->size+1 );
+	assert( r->buf != NULL );
+	r->pos = r->end = 0;
+	r->eof = false;
+	r->err = 0;
+	return r;
+}
+
+
+/*
+ * bool more = fill( r );
+ *	Discard the lines already handed out, and read another block
+ *	after the partial line left in r's buffer.  Return false at EOF,
+ *	or if read() fails (setting r->err).
+ */
+static bool fill( linereader r )
+{
+	int left = r->end - r->pos;
+	if( r->pos > 0 )
+	{
+		memmove( r->buf, r->buf + r->pos, left );
+		r->pos = 0;
+		r->end = left;
+	}
+	if( r->end == r->size )		/* one line fills the buffer */
+	{
+		r->size *= 2;
+		r->buf = (char *) realloc( r->buf, r->size+1 );
+		assert( r->buf != NULL );
+	}
+	for(;;)
+	{
+		ssize_t n = read( r->fd, r->buf + r->end, r->size - r->end );
+		if( n > 0 )
+		{
+			r->end += n;
+			return true;
+		}
+		if( n == 0 )
+		{
+			r->eof = true;
+			return false;
+		}
+		if( errno != EINTR )
+		{
+			r->eof = true;
+			r->err = errno;
+			return false;
+		}
+	}
+}
+
+
+/*
+ * bool ok = lrNext( r, &line, &len );
+ *	Read the next line from r: if there is one, set line to point
+ *	at it (without the newline, but '\0' terminated) and len to its
+ *	length, and return true; return false at EOF, or if reading
+ *	failed (see lrError()).  The view is only valid until the next
+ *	call of lrNext().
+ */
+bool lrNext( linereader r, char **line, int *len )
+{
+	int scanned = r->pos;		/* no newline in [pos..scanned) */
+	for(;;)
+	{
+		char *nl = memchr( r->buf + scanned, '\n', r->end - scanned );
+		if( nl != NULL )
+		{
+			*nl = '\0';
+			*line = r->buf + r->pos;
+			*len = nl - *line;
+			r->pos = nl - r->buf + 1;
+			return true;
+		}
+		scanned = r->end - r->pos;	/* where it'll be after fill */
+		if( r->eof || ! fill( r ) )
+		{
+			break;
+		}
+	}
+
+	/* EOF: hand out any final unterminated line, but not a partial
+	 * line cut short by a read error
+	 */
+	if( r->pos == r->end || r->err != 0 )
+	{
+		return false;
+	}
+	r->buf[r->end] = '\0';
+	*line = r->buf + r->pos;
+	*len = r->end - r->pos;
+	r->pos = r->end;
+	return true;
+}
+
+
+/*
+ * int err = lrError( r );
+ *	Return the errno of the read() that failed and made lrNext()
+ *	return false, or 0 if r has only reached EOF (or not even that).
+ */
+int lrError( linereader r )
+{
+	return r->err;
+}
+
+
+/*
+ * lrFree( r );
+ *	Free the line reader r (but don't close its file descriptor).
+ */
+void lrFree( linereader r )
+{
+	free( (void *)r->buf );
+	free( (void *)r );
+}
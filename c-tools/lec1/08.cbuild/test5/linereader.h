@@ -0,0 +1,12 @@
+/*
+ *   linereader.h: read lines of any length from a file descriptor,
+ *		   in large blocks, handing out views into the block
+ *		   buffer rather than copying each line.
+ */
+
+typedef struct linereader_s *linereader;
+
+extern linereader lrCreate( int fd );
+extern bool lrNext( linereader r, char ** line, int * len );
+extern int lrError( linereader r );
+extern void lrFree( linereader r );
@@ -0,0 +1,233 @@
+/*
+ *   mkpairs: generate "parent: child" pairs for testing and benchmarking
+ *	      transform, quickly and at any scale, with control over how
+ *	      skewed the families are.  A fast C replacement for mkpcpairs.
+ *
+ *		usage: mkpairs [-n npairs] [-N nnames] [-s skew] [-d duprate]
+ *			       [-r seed] > output
+ *		-n: how many pairs to write (default 1000000)
+ *		-N: how many distinct names to use (default npairs/10)
+ *		-s: Zipf exponent for choosing parents: 0 chooses them
+ *		    uniformly, 1 (the default) makes the k'th most popular
+ *		    parent k times less likely than the most popular
+ *		-d: the fraction of pairs that repeat a recent pair
+ *		    (default 0.1)
+ *		-r: random seed (default 1): the same arguments always
+ *		    produce the same output
+ *
+ *	Children are chosen uniformly from all the other names, so the
+ *	same names are both parents and children.  Name number k is k scrambled
+ *	by a bijection and spelt in base 26, so names are distinct, about
+ *	7 letters long, and popularity doesn't correlate with spelling.
+ *	Parents are drawn with rejection-inversion sampling (Hormann and
+ *	Derflinger), which takes O(1) time and space per sample however
+ *	many names there are.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <math.h>
+#include <unistd.h>
+
+
+#define	RECENT		4096		/* duplicates repeat one of these */
+#define	OUTBUF		(1024*1024)
+
+
+static uint64_t rngstate;
+
+/* splitmix64: a fast, good enough, seedable generator */
+static uint64_t rng( void )
+{
+	uint64_t z = (rngstate += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/* a uniform double in [0,1) */
+static double uniform( void )
+{
+	return (rng() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+/* The Zipf sampler: P(k) is proportional to 1/k^s for k in 1..n */
+static double zs;			/* the exponent s */
+static double zhx1, zhn, zsv;		/* precomputed by zipfinit() */
+
+static double helper1( double x )	/* log(1+x)/x, accurately */
+{
+	return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x * (0.5 - x / 3);
+}
+
+static double helper2( double x )	/* (exp(x)-1)/x, accurately */
+{
+	return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x * 0.5 * (1 + x / 3);
+}
+
+static double zh( double x )
+{
+	return exp( -zs * log(x) );
+}
+
+static double zhintegral( double x )
+{
+	double lx = log( x );
+	return helper2( (1 - zs) * lx ) * lx;
+}
+
+static double zhintegralinverse( double x )
+{
+	double t = x * (1 - zs);
+	if( t < -1 )
+	{
+		t = -1;
+	}
+	return exp( helper1(t) * x );
+}
+
+static void zipfinit( long n, double s )
+{
+	zs = s;
+	zhx1 = zhintegral( 1.5 ) - 1;
+	zhn = zhintegral( n + 0.5 );
+	zsv = 2 - zhintegralinverse( zhintegral(2.5) - zh(2) );
+}
+
+static long zipf( long n )
+{
+	for(;;)
+	{
+		double u = zhn + uniform() * (zhx1 - zhn);
+		double x = zhintegralinverse( u );
+		long k = (long)(x + 0.5);
+		if( k < 1 )
+		{
+			k = 1;
+		} else if( k > n )
+		{
+			k = n;
+		}
+		if( k - x <= zsv || u >= zhintegral(k + 0.5) - zh(k) )
+		{
+			return k;
+		}
+	}
+}
+
+
+/*
+ * int len = spell( k, buf );
+ *	Write the name of name number k into buf, returning its length.
+ */
+static int spell( uint32_t k, char *buf )
+{
+	uint32_t x = k * 2654435761u;		/* odd, so a bijection */
+	x ^= x >> 16;				/* also a bijection */
+	char tmp[8];
+	int len = 0;
+	do
+	{
+		tmp[len++] = 'a' + x % 26;
+		x /= 26;
+	} while( x > 0 );
+	int i;
+	for( i = 0; i < len; i++ )
+	{
+		buf[i] = tmp[len-1-i];
+	}
+	buf[0] += 'A' - 'a';
+	return len;
+}
+
+
+static char out[OUTBUF + 64];
+static int outlen = 0;
+
+static void flushout( void )
+{
+	if( fwrite( out, 1, outlen, stdout ) != (size_t)outlen )
+	{
+		perror( "mkpairs: write" );
+		exit(1);
+	}
+	outlen = 0;
+}
+
+
+int main( int argc, char **argv )
+{
+	long npairs = 1000000;
+	long nnames = 0;
+	double skew = 1.0;
+	double duprate = 0.1;
+	long seed = 1;
+	int opt;
+	while( (opt = getopt( argc, argv, "n:N:s:d:r:" )) != -1 )
+	{
+		switch( opt )
+		{
+		case 'n': npairs = atol( optarg ); break;
+		case 'N': nnames = atol( optarg ); break;
+		case 's': skew = atof( optarg ); break;
+		case 'd': duprate = atof( optarg ); break;
+		case 'r': seed = atol( optarg ); break;
+		default:
+			fprintf( stderr, "Usage: mkpairs [-n npairs] [-N nnames] "
+				 "[-s skew] [-d duprate] [-r seed]\n" );
+			exit(1);
+		}
+	}
+	if( nnames == 0 )
+	{
+		nnames = npairs / 10 > 2 ? npairs / 10 : 2;
+	}
+	if( npairs < 0 || nnames < 2 || nnames > UINT32_MAX || skew < 0 ||
+	    duprate < 0 || duprate > 1 )
+	{
+		fprintf( stderr, "mkpairs: bad arguments\n" );
+		exit(1);
+	}
+	rngstate = seed;
+	zipfinit( nnames, skew );
+
+	uint32_t recentp[RECENT], recentc[RECENT];
+	long nrecent = 0;
+	long i;
+	for( i = 0; i < npairs; i++ )
+	{
+		uint32_t p, c;
+		if( nrecent > 0 && uniform() < duprate )
+		{
+			long r = rng() % (nrecent < RECENT ? nrecent : RECENT);
+			p = recentp[r];
+			c = recentc[r];
+		} else
+		{
+			p = zipf( nnames ) - 1;
+			do
+			{
+				c = rng() % nnames;
+			} while( c == p );
+			recentp[nrecent % RECENT] = p;
+			recentc[nrecent % RECENT] = c;
+			nrecent++;
+		}
+		outlen += spell( p, out + outlen );
+		out[outlen++] = ':';
+		out[outlen++] = ' ';
+		outlen += spell( c, out + outlen );
+		out[outlen++] = '\n';
+		if( outlen >= OUTBUF )
+		{
+			flushout();
+		}
+	}
+	flushout();
+	return 0;
+}
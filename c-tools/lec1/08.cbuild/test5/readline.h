@@ -1,5 +0,0 @@
-/*
- *   readline.h: utility function readline..
- */
-
-extern bool readline( FILE * in, char * buf, int maxlen );
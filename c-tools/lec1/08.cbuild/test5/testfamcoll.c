@@ -8,7 +8,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 #include <set.h>
 #include <hash.h>
@@ -79,6 +83,34 @@ void testcontains( famcoll f, char *parent, char *csvchildren )
 	testint( nfound, nincsv, msg );
 }
 
+/*
+ * countpairs_cb: near-duplicate callback, count the pairs found
+ *	and remember the last one in the "p1,p2" string at extra.
+ */
+static int npairs;
+static void countpairs_cb( char *p1, char *p2, double similarity, void *extra )
+{
+	npairs++;
+	sprintf( (char *)extra, "%s,%s", p1, p2 );
+}
+
+
+/*
+ * countfamily_cb: famcollForeach callback, count the families and
+ *	their children in the int[2] at extra; countname_cb counts
+ *	names in extra[1].
+ */
+static void countname_cb( setkey name, void *extra )
+{
+	((int *)extra)[1]++;
+}
+static void countfamily_cb( char *parent, set kids, void *extra )
+{
+	((int *)extra)[0]++;
+	((int *)extra)[1] += setNMembers( kids );
+}
+
+
 int main( int argc, char **argv )
 {
 	if( argc > 1 )
@@ -139,6 +171,261 @@ int main( int argc, char **argv )
 	printf( "final families:\n" );
 	famcollDump( stdout, f );
 
+	int count[2] = { 0, 0 };
+	famcollForeach( f, &countfamily_cb, (void *)count );
+	testint( count[0], 3, "famcollForeach visits 3 families" );
+	testint( count[1], 6, "..with 6 children between them" );
+
+	FILE *tmp = tmpfile();
+	famcollDumpSorted( tmp, f, 2 );
+	rewind( tmp );
+	char dump[1024];
+	int len = fread( dump, 1, sizeof(dump)-1, tmp );
+	dump[len] = '\0';
+	fclose( tmp );
+	testcond( strcmp( dump,
+		"\none: a,b,c\nthree: z\ntwo: a,d\n\nThere are 3 families\n" ) == 0,
+		"sorted dump" );
+
+	famcoll frozen = famcollCreate();
+	famcollAddChild( frozen, "two", "d" );
+	famcollAddChild( frozen, "one", "c" );
+	famcollAddChild( frozen, "one", "a" );
+	famcollAddChild( frozen, "three", "z" );
+	famcollAddChild( frozen, "one", "b" );
+	famcollAddChild( frozen, "two", "a" );
+	famcollFreeze( frozen );
+	printf( "froze a copy of f\n" );
+	testint( famcollNFamilies(frozen), 3, "frozen has 3 families" );
+	testcond( famcollIsChild( frozen, "one", "b" ), "b is a child of frozen one" );
+	testcond( ! famcollIsChild( frozen, "one", "d" ), "d isn't a child of frozen one" );
+	testcond( ! famcollIsChild( frozen, "four", "a" ), "frozen four has no children" );
+	testcontains( frozen, "one", "a,b,c" );
+	testcontains( frozen, "two", "a,d" );
+	testcond( ! famcollForeachChild( frozen, "a", NULL, NULL ),
+		"a has no family in frozen" );
+	tmp = tmpfile();
+	famcollDumpSorted( tmp, frozen, 1 );
+	rewind( tmp );
+	len = fread( dump, 1, sizeof(dump)-1, tmp );
+	dump[len] = '\0';
+	fclose( tmp );
+	testcond( strcmp( dump,
+		"\none: a,b,c\nthree: z\ntwo: a,d\n\nThere are 3 families\n" ) == 0,
+		"frozen sorted dump" );
+	famcollEnableParents( frozen );
+	testint( setNMembers( famcollParents( frozen, "a" ) ), 2,
+		"a has 2 parents in frozen" );
+	testcond( famcollIsDescendant( frozen, "two", "d" ),
+		"d descends from frozen two" );
+	famcollFree( frozen );
+
+	famcollEnableSketches( f );
+	famcollAddChild( f, "four", "c" );
+	famcollAddChild( f, "four", "b" );
+	famcollAddChild( f, "four", "a" );
+	printf( "added <c>,<b>,<a> to <four> in f (with sketches enabled)\n" );
+	testcond( famcollSimilarity( f, "one", "four" ) == 1.0,
+		"similarity(one,four) == 1" );
+	testcond( famcollSimilarity( f, "one", "three" ) == 0.0,
+		"similarity(one,three) == 0" );
+	double n = famcollUnionSize( f, "one", "two" );
+	testcond( n > 3.5 && n < 4.5, "unionsize(one,two) ~ 4" );
+	n = famcollDistinctChildren( f );
+	testcond( n > 4.5 && n < 5.5, "distinctchildren(f) ~ 5" );
+
+	char pair[1024] = "";
+	npairs = 0;
+	famcollNearDuplicates( f, 0.9, &countpairs_cb, (void *)pair );
+	testint( npairs, 1, "1 near-duplicate pair" );
+	teststring( pair, "four,one", "near-duplicate pair is four,one" );
+
+	famcollEnableParents( f );
+	famcollAddChild( f, "three", "a" );
+	printf( "added <a> to <three> in f (with reverse index enabled)\n" );
+	set ps = famcollParents( f, "a" );
+	testint( setNMembers(ps), 4, "a has 4 parents" );
+	testcond( setIn( ps, "one" ) && setIn( ps, "two" ) &&
+		  setIn( ps, "three" ) && setIn( ps, "four" ),
+		"a's parents are one,two,three,four" );
+	count[1] = 0;
+	testcond( famcollForeachParent( f, "a", &countname_cb, (void *)count ) &&
+		  count[1] == 4, "famcollForeachParent visits a's 4 parents" );
+	testcond( ! famcollForeachParent( f, "one", &countname_cb, (void *)count ),
+		"famcollForeachParent finds no parents of one" );
+	ps = famcollParents( f, "z" );
+	testint( setNMembers(ps), 1, "z has 1 parent" );
+	testcond( setIn( ps, "three" ), "z's parent is three" );
+	testcond( famcollParents( f, "one" ) == NULL, "one has no parents" );
+
+	famcoll g = famcollCreate();
+	famcollAddChild( g, "gran", "mum" );
+	famcollAddChild( g, "mum", "kid" );
+	famcollAddChild( g, "dad", "kid" );
+	testcond( famcollIsDescendant( g, "gran", "kid" ), "kid descends from gran" );
+	testcond( ! famcollIsDescendant( g, "kid", "gran" ), "gran doesn't descend from kid" );
+	testcond( ! famcollIsDescendant( g, "dad", "mum" ), "mum doesn't descend from dad" );
+	famcollAddChild( g, "kid", "grandkid" );
+	printf( "added <grandkid> to <kid> in g\n" );
+	testcond( famcollIsDescendant( g, "gran", "grandkid" ),
+		"grandkid descends from gran (incremental)" );
+	famcollAddChild( g, "mum", "dad" );
+	printf( "added <dad> to <mum> in g\n" );
+	testcond( famcollIsDescendant( g, "mum", "grandkid" ) &&
+		  famcollIsDescendant( g, "gran", "dad" ),
+		"dad descends from gran (incremental)" );
+	set desc = famcollDescendants( g, "mum" );
+	testint( setNMembers( desc ), 3, "mum has 3 descendants" );
+	testcond( setIn( desc, "dad" ) && setIn( desc, "kid" ) &&
+		  setIn( desc, "grandkid" ), "mum's descendants are dad,kid,grandkid" );
+	setFree( desc );
+	set anc = famcollAncestors( g, "kid" );
+	testint( setNMembers( anc ), 3, "kid has 3 ancestors" );
+	setFree( anc );
+	famcollAddChild( g, "grandkid", "gran" );
+	printf( "added <gran> to <grandkid> in g: a cycle\n" );
+	testcond( famcollIsDescendant( g, "gran", "gran" ),
+		"gran is her own descendant" );
+	famcollFree( g );
+
+	g = famcollCreate();
+	famcollAddChild( g, "five", "y" );
+	famcollAddChild( g, "six", "x" );
+	famcoll h = famcollCreate();
+	famcollEnableSketches( g );
+	famcollEnableSketches( h );
+	famcollEnableParents( g );
+	famcollEnableParents( h );
+	famcollAddChild( h, "seven", "x" );
+	famcollAddChild( h, "six", "z" );
+	famcollMerge( h, g );
+	printf( "merged g's families into h\n" );
+	testint( famcollNFamilies(g), 0, "g has 0 families after merge" );
+	testint( famcollNFamilies(h), 3, "h has 3 families after merge" );
+	testint( setNMembers( famcollParents( h, "x" ) ), 2,
+		"x has 2 parents after merge" );
+	testcontains( h, "six", "x,z" );
+	testcond( famcollSimilarity( h, "six", "six" ) == 1.0 &&
+		  famcollUnionSize( h, "six", "seven" ) < 2.5,
+		"overlapping sketches merged" );
+	testcontains( h, "five", "y" );
+	testcond( famcollSimilarity( h, "five", "six" ) == 0.0,
+		"sketches moved too" );
+	famcollFree( g );
+	famcollFree( h );
+
+	g = famcollCreate();
+	famcollAddChild( g, "small", "a" );
+	famcollAddChild( g, "mid", "a" );
+	famcollAddChild( g, "mid", "b" );
+	famcollEnableStats( g, 2 );
+	famcollAddChild( g, "big", "a" );
+	famcollAddChild( g, "big", "b" );
+	famcollAddChild( g, "big", "c" );
+	famcollAddChild( g, "big", "c" );	/* no change */
+	famcollAddChild( g, "small", "b" );
+	famcollAddChild( g, "small", "c" );
+	famcollAddChild( g, "small", "d" );
+	famcollstats *st = famcollStats( g );
+	testint( st->nfamilies, 3, "stats: 3 families" );
+	testlong( st->npairs, 9, "stats: 9 pairs" );
+	testint( st->maxchildren, 4, "stats: biggest family has 4 children" );
+	testint( st->histogram[2], 1, "stats: 1 family of 2" );
+	testint( st->histogram[3], 1, "stats: 1 family of 3" );
+	testint( st->ntop, 2, "stats: top 2" );
+	teststring( st->top[0].parent, "small", "stats: small is now biggest" );
+	teststring( st->top[1].parent, "big", "stats: then big" );
+	famcollStatsFree( st );
+	h = famcollCreate();
+	famcollEnableStats( h, 2 );
+	famcollAddChild( h, "other", "x" );
+	famcollMerge( h, g );
+	famcollAddChild( h, "mid", "c" );
+	famcollAddChild( h, "mid", "d" );
+	famcollAddChild( h, "mid", "e" );
+	st = famcollStats( h );
+	testint( st->nfamilies, 4, "merged stats: 4 families" );
+	testint( st->histogram[1], 1, "merged stats: 1 family of 1" );
+	teststring( st->top[0].parent, "mid", "merged stats: mid is biggest" );
+	testint( st->top[0].nchildren, 5, "merged stats: mid has 5 children" );
+	famcollStatsFree( st );
+	famcollFree( g );
+	famcollFree( h );
+
+	famcoll shard[5];
+	int i;
+	for( i = 0; i < 5; i++ )
+	{
+		shard[i] = famcollCreate();
+		char kid[10];
+		sprintf( kid, "k%d", i );
+		famcollAddChild( shard[i], "everyone", kid );
+		famcollAddChild( shard[i], kid+1, kid );
+	}
+	g = famcollMergeAll( shard, 5, 2 );
+	testint( famcollNFamilies(g), 6, "merged 5 shards: 6 families" );
+	testcontains( g, "everyone", "k0,k1,k2,k3,k4" );
+	testcontains( g, "4", "k4" );
+	famcollFree( g );
+
+	char dir[] = "/tmp/testfamcollXXXXXX";
+	char *made = mkdtemp( dir );
+	assert( made != NULL );
+	g = famcollOpen( dir );
+	famcollAddChild( g, "one", "a" );
+	famcollAddChild( g, "one", "b" );
+	famcollFree( g );
+	g = famcollOpen( dir );
+	testint( famcollNFamilies(g), 1, "reopened g has 1 family (from log)" );
+	testcontains( g, "one", "a,b" );
+	famcollSnapshot( g );
+	famcollAddChild( g, "two", "c" );
+	famcollFree( g );
+	g = famcollOpen( dir );
+	testint( famcollNFamilies(g), 2, "reopened g has 2 families (snapshot+log)" );
+	testcontains( g, "one", "a,b" );
+	testcontains( g, "two", "c" );
+	famcollFree( g );
+
+	/* a record torn by a crash is dropped, and the log repaired */
+	char path[1024];
+	sprintf( path, "%s/log", dir );
+	int fd = open( path, O_WRONLY|O_APPEND );
+	assert( fd >= 0 );
+	ssize_t wrote = write( fd, "\005\0\0\0\003\0\0\0thr", 11 );
+	assert( wrote == 11 );
+	close( fd );
+	g = famcollOpen( dir );
+	testint( famcollNFamilies(g), 2, "torn log record is dropped" );
+	famcollAddChild( g, "three", "d" );
+	famcollFree( g );
+	g = famcollOpen( dir );
+	testcontains( g, "three", "d" );
+
+	/* merging enough pairs into a persistent famcoll snapshots it */
+	famcoll big = famcollCreate();
+	for( i = 0; i < 100000; i++ )
+	{
+		char kid[20];
+		sprintf( kid, "kid%d", i );
+		famcollAddChild( big, "many", kid );
+	}
+	famcollMerge( g, big );
+	famcollFree( big );
+	famcollFree( g );
+	struct stat sb;
+	testcond( stat( path, &sb ) == 0 && sb.st_size == 0,
+		  "big merge emptied the log into a snapshot" );
+	g = famcollOpen( dir );
+	testint( famcollNFamilies(g), 4, "reopened after big merge: 4 families" );
+	testcond( famcollIsChild( g, "many", "kid99999" ),
+		  "reopened after big merge: many has kid99999" );
+	famcollFree( g );
+	unlink( path );
+	sprintf( path, "%s/snapshot", dir );
+	unlink( path );
+	rmdir( dir );
+
 	famcollFree( f );
 
 	return 0;
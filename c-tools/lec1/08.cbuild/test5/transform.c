@@ -1,7 +1,18 @@
 /*
  *   transform: read parent: child lines from input, build a hash-of-sets
  *   	        and then print out collected families: each parent and all
- *		their children (currently not in sorted order).
+ *		their children, in sorted order.
+ *
+ *		usage: transform [-j nthreads | -m megabytes | -d dir] < input
+ *		-j builds (and prints) the hash-of-sets using nthreads
+ *		threads, producing identical output.
+ *		-m doesn't build a hash-of-sets at all: it gathers the
+ *		families by an external sort using at most (about) the
+ *		given number of megabytes, spilling sorted runs into
+ *		$TMPDIR (or /tmp), again producing identical output.
+ *		-d adds the input to the persistent collection stored in
+ *		directory dir (loading it from dir's snapshot and log,
+ *		and logging the new pairs), and prints all of it.
  */
 
 #include <stdio.h>
@@ -9,12 +20,15 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #include <set.h>
 #include <hash.h>
 
-#include "readline.h"
+#include "linereader.h"
 #include "famcoll.h"
+#include "ingest.h"
+#include "extsort.h"
 
 
 
@@ -22,15 +36,34 @@ static famcoll f;
 
 //#define DEBUG
 
-#define STRSIZE 1024
-
-int main( int argc, char **argv )
+/*
+ * readerror( r );
+ *	If line reader r stopped because reading failed, rather than
+ *	at EOF, say so and exit: don't print a truncated collection.
+ */
+static void readerror( linereader r )
 {
-	char line[STRSIZE];
+	int err = lrError( r );
+	if( err != 0 )
+	{
+		fprintf( stderr, "transform: read error: %s\n", strerror( err ) );
+		exit(1);
+	}
+}
+
 
-	f = famcollCreate();
+/*
+ * ingest( fd, new );
+ *	Read all "parent: child" lines from fd, one at a time, and
+ *	add them to famcoll new.
+ */
+static void ingest( int fd, famcoll new )
+{
+	char *line;
+	int len;
 
-	while( readline(stdin, line, STRSIZE ) != 0 )
+	linereader r = lrCreate( fd );
+	while( lrNext( r, &line, &len ) )
 	{
 		//printf( "// debug: read line '%s'\n", line );
 		char *parent = strtok( line, ": " );
@@ -38,13 +71,98 @@ int main( int argc, char **argv )
 		char *child = strtok( NULL, ": " );
 		assert( child != NULL );
 		//printf( "// debug parent='%s', child='%s'\n", parent, child );
-		famcollAddChild( f, parent, child );
+		famcollAddChild( new, parent, child );
 		#ifdef DEBUG
 		printf( "debug: added <%s> to <%s>\n", child, parent );
 		#endif
 	}
+	readerror( r );
+	lrFree( r );
+}
+
+
+/*
+ * spillmode( fd, budget );
+ *	Read all "parent: child" lines from fd, and print out the
+ *	families in sorted order, using an external sort that keeps
+ *	(about) budget bytes in memory.
+ */
+static void spillmode( int fd, size_t budget )
+{
+	char *line;
+	int len;
+
+	char *tmpdir = getenv( "TMPDIR" );
+	extsort e = extsortCreate( budget, tmpdir != NULL ? tmpdir : "/tmp" );
+
+	linereader r = lrCreate( fd );
+	while( lrNext( r, &line, &len ) )
+	{
+		char *parent = strtok( line, ": " );
+		assert( parent != NULL );
+		char *child = strtok( NULL, ": " );
+		assert( child != NULL );
+		extsortAdd( e, parent, child );
+	}
+	readerror( r );
+	lrFree( r );
+
+	extsortDump( stdout, e );
+	extsortFree( e );
+}
+
+
+int main( int argc, char **argv )
+{
+	int nthreads = 1;
+	int megabytes = 0;
+	char *dir = NULL;
+	if( argc == 3 && strcmp( argv[1], "-j" ) == 0 )
+	{
+		nthreads = atoi( argv[2] );
+	} else if( argc == 3 && strcmp( argv[1], "-m" ) == 0 )
+	{
+		megabytes = atoi( argv[2] );
+		if( megabytes < 1 )
+		{
+			fprintf( stderr, "transform: megabytes must be >= 1\n" );
+			exit(1);
+		}
+	} else if( argc == 3 && strcmp( argv[1], "-d" ) == 0 )
+	{
+		dir = argv[2];
+	} else if( argc != 1 )
+	{
+		fprintf( stderr,
+			"Usage: transform [-j nthreads | -m megabytes | -d dir] < input\n" );
+		exit(1);
+	}
+	if( nthreads < 1 )
+	{
+		fprintf( stderr, "transform: nthreads must be >= 1\n" );
+		exit(1);
+	}
+
+	if( megabytes > 0 )
+	{
+		spillmode( 0, (size_t)megabytes * 1024 * 1024 );
+		return 0;
+	}
+
+	if( dir != NULL )
+	{
+		f = famcollOpen( dir );
+		ingest( 0, f );
+	} else if( nthreads > 1 )
+	{
+		f = ingestParallel( 0, nthreads );
+	} else
+	{
+		f = famcollCreate();
+		ingest( 0, f );
+	}
 
-	famcollDump( stdout, f );
+	famcollDumpSorted( stdout, f, nthreads );
 
 	famcollFree( f );
 
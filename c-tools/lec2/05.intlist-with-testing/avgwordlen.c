@@ -1,62 +1,50 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
 
 #include "intlist.h"
+#include "chunklist.h"
+#include "reduce.h"
+#include "wordstats.h"
 #include "defns.h"
 
 
 /*
  * avgwordlen: find the average length of words in the
- * 	       unix dictionary, using linked lists.
+ * 	       unix dictionary (or any other file of words, one per
+ *	       line), in a single streaming pass using the wordstats
+ *	       engine, optionally with several threads.
+ *
+ *	usage: avgwordlen [-j nthreads] [wordfile]
  */
 
-typedef struct {
-	int sum;
-	int total;
-} sum_and_total;
 
-
-void sumcb( int el, void *stsofar )
-{
-	sum_and_total *data = (sum_and_total *)stsofar;
-	data->sum += el;
-	data->total++;
-}
-
-
-int main( void )
+int main( int argc, char **argv )
 {
-	intlist l = intlist_nil();
-	FILE *dict = fopen( DICTFILE, "r" );
-	if( dict == NULL )
-	{
-		fprintf( stderr, "Can't open dictionary file %s\n", DICTFILE );
-		exit(1);
-	}
-	/* foreach line in <dict> */
-	char line[1024];
-	while( fgets( line, 1024, dict ) != NULL )
+	int nthreads = 1;
+	int opt;
+	while( (opt = getopt( argc, argv, "j:" )) != -1 )
 	{
-		/* chomp line */
-		int len = strlen(line);
-		if( line[len-1] == '\n' )
+		if( opt != 'j' || (nthreads = atoi( optarg )) < 1 )
 		{
-			line[len-1] = '\0';
-			len--;
+			fprintf( stderr, "Usage: avgwordlen [-j nthreads] [wordfile]\n" );
+			exit(1);
 		}
-		/* prepend length(line) to l */
-		l = intlist_cons( len, l );
 	}
-	fclose( dict );
-
-	sum_and_total data = { 0, 0 };
-	foreach_intlist( sumcb, &data, l );
+	char *file = optind < argc ? argv[optind] : DICTFILE;
 
-	printf( "sum(word lengths) = %d, total = %d words, avg = %.2f letters per word\n",
-		data.sum, data.total, data.sum/(double)data.total );
+	wordstats data;
+	init_wordstats( &data );
+	if( ! wordstats_file( &data, file, nthreads ) )
+	{
+		fprintf( stderr, "Can't open dictionary file %s\n", file );
+		exit(1);
+	}
 
-	free_intlist( l );
+	printf( "sum(word lengths) = %ld, total = %ld words, avg = %.2f letters per word\n",
+		(long)data.s.sum, data.s.count, intsummary_mean( &data.s ) );
 
 	return(0);
 }
@@ -0,0 +1,178 @@
+/*
+ * unrolled list-of-integers module: the implementation
+ *
+ * A node's ints fill v[] upwards, and a list using n of them has
+ * v[n-1] as its first element.  Consing onto a list whose node has
+ * used == n (i.e. nobody has consed onto this list before) and room
+ * to spare just claims v[n]; otherwise it starts a new node.  So a
+ * chain of conses onto the latest list fills whole chunks, but a
+ * second cons onto an older list can never overwrite an int that
+ * some other list owns.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "strbuf.h"
+#include "chunklist.h"
+
+
+#define NEW(t) ((t)malloc(sizeof(struct t)))
+
+
+chunklist chunklist_cons( int first, chunklist next )
+{
+	chunklist new;
+	if( next.c != NULL && next.c->used == next.n && next.n < CHUNKSIZE )
+	{
+		new.c = next.c;
+	} else
+	{
+		new.c = NEW(chunk);
+		assert( new.c != NULL );
+		new.c->next = next.c;
+		new.c->nextn = next.n;
+		new.c->used = 0;
+		next.n = 0;
+	}
+	new.c->v[next.n] = first;
+	new.n = next.n + 1;
+	new.c->used = new.n;
+	return new;
+}
+
+
+kind_of_chunklist chunklist_kind( chunklist this )
+{
+	if( this.c == NULL )
+	{
+		return chunklist_is_nil;
+	}
+	return chunklist_is_cons;
+}
+
+
+void get_chunklist_cons( chunklist this, int *first, chunklist *next )
+{
+	*first = this.c->v[this.n-1];
+	if( this.n > 1 )
+	{
+		next->c = this.c;
+		next->n = this.n - 1;
+	} else
+	{
+		next->c = this.c->next;
+		next->n = this.c->nextn;
+	}
+}
+
+
+/*
+ * append_chunklist( b, p );
+ *	Append p, in "[ 1,2,3 ]" form, to string builder b.
+ */
+void append_chunklist( strbuf b, chunklist p )
+{
+	bool first = true;
+	strbuf_addstr( b, "[ " );
+	for( ; p.c != NULL; p.n = p.c->nextn, p.c = p.c->next )
+	{
+		int i;
+		for( i = p.n-1; i >= 0; i-- )
+		{
+			if( ! first )
+			{
+				strbuf_addchar( b, ',' );
+			}
+			strbuf_addint( b, p.c->v[i] );
+			first = false;
+		}
+	}
+	strbuf_addstr( b, " ]" );
+}
+
+
+#define PRINTBUF	65536	/* print_chunklist() writes this much at a time */
+
+void print_chunklist( FILE *f, chunklist p )
+{
+	bool first = true;
+	strbuf b = new_strbuf();
+	strbuf_addstr( b, "[ " );
+	for( ; p.c != NULL; p.n = p.c->nextn, p.c = p.c->next )
+	{
+		int i;
+		for( i = p.n-1; i >= 0; i-- )
+		{
+			if( ! first )
+			{
+				strbuf_addchar( b, ',' );
+			}
+			strbuf_addint( b, p.c->v[i] );
+			first = false;
+		}
+		if( strbuf_len(b) >= PRINTBUF )
+		{
+			fwrite( strbuf_str(b), 1, strbuf_len(b), f );
+			strbuf_clear( b );
+		}
+	}
+	strbuf_addstr( b, " ]" );
+	fwrite( strbuf_str(b), 1, strbuf_len(b), f );
+	free_strbuf( b );
+}
+
+
+/*
+ * char *s = chunklist_string( p );
+ *	Return p in "[ 1,2,3 ]" form as a malloc()d string.
+ */
+char *chunklist_string( chunklist p )
+{
+	strbuf b = new_strbuf();
+	append_chunklist( b, p );
+	return strbuf_finish( b );
+}
+
+
+/*
+ * sprint_chunklist( s, p );
+ *	Write p in "[ 1,2,3 ]" form into s, which must be big enough:
+ *	prefer chunklist_string() or append_chunklist().
+ */
+void sprint_chunklist( char *s, chunklist p )
+{
+	strbuf b = new_strbuf();
+	append_chunklist( b, p );
+	memcpy( s, strbuf_str(b), strbuf_len(b) + 1 );
+	free_strbuf( b );
+}
+
+
+void foreach_chunklist( foreach_chunklist_callback cb, void *data, chunklist p )
+{
+	for( ; p.c != NULL; p.n = p.c->nextn, p.c = p.c->next )
+	{
+		int *v = p.c->v;
+		int i;
+		for( i = p.n-1; i >= 0; i-- )
+		{
+			(*cb)( v[i], data );
+		}
+	}
+}
+
+
+void free_chunklist( chunklist p )
+{
+	chunk c = p.c;
+	while( c != NULL )
+	{
+		chunk cn = c->next;
+		free( c );
+		c = cn;
+	}
+}
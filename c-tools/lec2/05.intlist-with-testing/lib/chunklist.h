@@ -0,0 +1,52 @@
+/*
+ * chunklist: an unrolled list-of-integers module.  Each node holds a
+ *	      block of up to CHUNKSIZE ints, so a list of n ints takes
+ *	      about n/CHUNKSIZE mallocs and a little over 4 bytes per int,
+ *	      rather than intlist's n mallocs and 16 bytes per int.
+ *
+ *	      A chunklist is a small struct, passed around by value: the
+ *	      node holding its first element, and how many of that node's
+ *	      ints belong to this list.  cons, kind, get, foreach and free
+ *	      behave exactly like intlist's: in particular, chunklist_cons()
+ *	      leaves its tail argument intact, so several lists can be
+ *	      consed onto one tail (which free_chunklist() would free).
+ */
+
+#define CHUNKSIZE	60	/* makes a chunk 256 bytes on 64-bit machines */
+
+typedef struct chunk *chunk;
+struct chunk {
+	chunk	next;		/* the node holding the rest of the list */
+	int	nextn;		/* how many of next's ints are in the list */
+	int	used;		/* how many of v[] have ever been filled */
+	int	v[CHUNKSIZE];	/* the ints, last-consed at the highest index */
+};
+
+typedef struct {
+	chunk	c;		/* the node holding the first element */
+	int	n;		/* this list's elements are c->v[n-1..0] */
+} chunklist;
+
+
+typedef enum {
+	chunklist_is_nil,
+	chunklist_is_cons,
+} kind_of_chunklist;
+
+
+typedef void (*foreach_chunklist_callback)( int, void * );
+
+
+struct strbuf;		/* see strbuf.h */
+
+#define chunklist_nil() ((chunklist){ NULL, 0 })
+
+extern chunklist chunklist_cons( int first, chunklist next );
+extern kind_of_chunklist chunklist_kind( chunklist this );
+extern void get_chunklist_cons( chunklist this, int * first, chunklist * next );
+extern void append_chunklist( struct strbuf * b, chunklist p );
+extern void print_chunklist( FILE * f, chunklist p );
+extern char * chunklist_string( chunklist p );
+extern void sprint_chunklist( char * s, chunklist p );
+extern void foreach_chunklist( foreach_chunklist_callback cb, void * data, chunklist p );
+extern void free_chunklist( chunklist p );
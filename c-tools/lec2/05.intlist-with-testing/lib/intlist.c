@@ -5,7 +5,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <assert.h>
 
+#include "strbuf.h"
 #include "intlist.h"
 
 
@@ -16,6 +18,7 @@ intlist intlist_cons( int first, intlist next )
 {
 	intlist	new = NEW(intlist);
 	new->first = first;
+	new->refs = 1;
 	new->next = next;
 	return new;
 }
@@ -38,37 +41,75 @@ void get_intlist_cons( intlist this, int *first, intlist *next )
 }
 
 
-void print_intlist( FILE *f, intlist p )
+/*
+ * append_intlist( b, p );
+ *	Append p, in "[ 1,2,3 ]" form, to string builder b.
+ */
+void append_intlist( strbuf b, intlist p )
 {
-	fputs( "[ ", f );
+	strbuf_addstr( b, "[ " );
 	while( p != NULL )
 	{
-		fprintf( f, "%d", p->first );
+		strbuf_addint( b, p->first );
 		if( p->next != NULL )
 		{
-			fputs( ",", f );
+			strbuf_addchar( b, ',' );
 		}
 		p = p->next;
 	}
-	fputs( " ]", f );
+	strbuf_addstr( b, " ]" );
 }
 
 
-void sprint_intlist( char *s, intlist p )
+#define PRINTBUF	65536	/* print_intlist() writes this much at a time */
+
+void print_intlist( FILE *f, intlist p )
 {
-	strcpy( s, "[ " );
+	strbuf b = new_strbuf();
+	strbuf_addstr( b, "[ " );
 	while( p != NULL )
 	{
-		char tempstr[100];
-		sprintf( tempstr, "%d", p->first );
-		strcat( s, tempstr );
+		strbuf_addint( b, p->first );
 		if( p->next != NULL )
 		{
-			strcat( s, "," );
+			strbuf_addchar( b, ',' );
+		}
+		if( strbuf_len(b) >= PRINTBUF )
+		{
+			fwrite( strbuf_str(b), 1, strbuf_len(b), f );
+			strbuf_clear( b );
 		}
 		p = p->next;
 	}
-	strcat( s, " ]" );
+	strbuf_addstr( b, " ]" );
+	fwrite( strbuf_str(b), 1, strbuf_len(b), f );
+	free_strbuf( b );
+}
+
+
+/*
+ * char *s = intlist_string( p );
+ *	Return p in "[ 1,2,3 ]" form as a malloc()d string.
+ */
+char *intlist_string( intlist p )
+{
+	strbuf b = new_strbuf();
+	append_intlist( b, p );
+	return strbuf_finish( b );
+}
+
+
+/*
+ * sprint_intlist( s, p );
+ *	Write p in "[ 1,2,3 ]" form into s, which must be big enough:
+ *	prefer intlist_string() or append_intlist(), which can't overflow.
+ */
+void sprint_intlist( char *s, intlist p )
+{
+	strbuf b = new_strbuf();
+	append_intlist( b, p );
+	memcpy( s, strbuf_str(b), strbuf_len(b) + 1 );
+	free_strbuf( b );
 }
 
 
@@ -93,3 +134,291 @@ void free_intlist( intlist p )
 }
 
 
+/*
+ * intlist l = merge_intlist( a, b );
+ *	Merge sorted lists a and b into one sorted list, relinking
+ *	their cells.  Equal elements of a come before those of b.
+ */
+intlist merge_intlist( intlist a, intlist b )
+{
+	struct intlist head;
+	intlist tail = &head;
+	while( a != NULL && b != NULL )
+	{
+		if( b->first < a->first )
+		{
+			tail->next = b;
+			b = b->next;
+		} else
+		{
+			tail->next = a;
+			a = a->next;
+		}
+		tail = tail->next;
+	}
+	tail->next = a != NULL ? a : b;
+	return head.next;
+}
+
+
+/*
+ * intlist l = mergesort_intlist( p );
+ *	Stable bottom-up merge sort of p, relinking its cells.  bin[i]
+ *	holds a sorted run of 2^i cells (or nothing), and each new cell
+ *	is carried up through the full bins like a binary counter, so
+ *	this takes O(n log n) time and O(1) space.
+ */
+intlist mergesort_intlist( intlist p )
+{
+	intlist bin[64];
+	int nbins = 0;
+	while( p != NULL )
+	{
+		intlist run = p;
+		p = p->next;
+		run->next = NULL;
+		int i;
+		for( i = 0; i < nbins && bin[i] != NULL; i++ )
+		{
+			run = merge_intlist( bin[i], run );
+			bin[i] = NULL;
+		}
+		if( i == nbins )
+		{
+			nbins++;
+		}
+		bin[i] = run;
+	}
+	intlist result = NULL;
+	int i;
+	for( i = 0; i < nbins; i++ )
+	{
+		if( bin[i] != NULL )
+		{
+			result = merge_intlist( bin[i], result );
+		}
+	}
+	return result;
+}
+
+
+/*
+ * intlist l = radixsort_intlist( p );
+ *	Sort p by copying its elements into an array, LSD radix sorting
+ *	that a byte at a time (skipping bytes that are the same in every
+ *	element), and writing them back into p's cells in order.
+ *	O(n) time, O(n) temporary space; p's cells stay where they are.
+ */
+intlist radixsort_intlist( intlist p )
+{
+	if( p == NULL || p->next == NULL )
+	{
+		return p;
+	}
+
+	/* copy, flipping the sign bit so that unsigned order is signed order */
+	long n = 0, cap = 1024;
+	unsigned *a = malloc( cap * sizeof(unsigned) );
+	assert( a != NULL );
+	intlist q;
+	for( q = p; q != NULL; q = q->next )
+	{
+		if( n == cap )
+		{
+			cap *= 2;
+			a = realloc( a, cap * sizeof(unsigned) );
+			assert( a != NULL );
+		}
+		a[n++] = (unsigned)q->first ^ 0x80000000u;
+	}
+	unsigned *b = malloc( n * sizeof(unsigned) );
+	assert( b != NULL );
+	long i;
+	int shift;
+	for( shift = 0; shift < 32; shift += 8 )
+	{
+		long count[256];
+		memset( count, 0, sizeof(count) );
+		for( i = 0; i < n; i++ )
+		{
+			count[(a[i] >> shift) & 0xff]++;
+		}
+		if( count[(a[0] >> shift) & 0xff] == n )
+		{
+			continue;		/* all the same: nothing to do */
+		}
+		long pos = 0;
+		int d;
+		for( d = 0; d < 256; d++ )
+		{
+			long c = count[d];
+			count[d] = pos;
+			pos += c;
+		}
+		for( i = 0; i < n; i++ )
+		{
+			b[count[(a[i] >> shift) & 0xff]++] = a[i];
+		}
+		unsigned *t = a;
+		a = b;
+		b = t;
+	}
+	i = 0;
+	for( q = p; q != NULL; q = q->next )
+	{
+		q->first = (int)(a[i++] ^ 0x80000000u);
+	}
+	free( a );
+	free( b );
+	return p;
+}
+
+
+#define RADIXMIN	1024	/* sort_intlist() radix sorts lists this long */
+
+intlist sort_intlist( intlist p )
+{
+	long n = 0;
+	intlist q;
+	for( q = p; q != NULL && n < RADIXMIN; q = q->next )
+	{
+		n++;
+	}
+	return n < RADIXMIN ? mergesort_intlist( p ) : radixsort_intlist( p );
+}
+
+
+/*
+ * intlist l = dedupe_intlist( p );
+ *	Free all but the first cell of each run of equal elements in p
+ *	(so, on a sorted list, leave one cell per distinct element).
+ */
+intlist dedupe_intlist( intlist p )
+{
+	intlist q = p;
+	while( q != NULL )
+	{
+		intlist n = q->next;
+		if( n != NULL && n->first == q->first )
+		{
+			q->next = n->next;
+			free( n );
+		} else
+		{
+			q = n;
+		}
+	}
+	return p;
+}
+
+
+intlist intlist_share( intlist p )
+{
+	if( p != NULL )
+	{
+		p->refs++;
+	}
+	return p;
+}
+
+
+/*
+ * release_intlist( p );
+ *	Drop a reference to p: if that was the last one, free p's first
+ *	cell and drop its reference to the rest of the list, and so on.
+ */
+void release_intlist( intlist p )
+{
+	while( p != NULL && --p->refs == 0 )
+	{
+		intlist pn = p->next;
+		free( p );
+		p = pn;
+	}
+}
+
+
+#define SLABCELLS 4096		/* intlist cells per slab: 64KB */
+
+typedef struct slab *slab;
+struct slab {
+	slab		next;
+	struct intlist	cell[SLABCELLS];
+};
+
+struct intlist_pool {
+	slab	slabs;		/* all the slabs, newest first */
+	int	nused;		/* how many of slabs->cell[] are handed out */
+	intlist	freelist;	/* cells given back, linked through next */
+};
+
+
+intlist_pool new_intlist_pool( void )
+{
+	intlist_pool pool = NEW(intlist_pool);
+	assert( pool != NULL );
+	pool->slabs = NULL;
+	pool->nused = SLABCELLS;
+	pool->freelist = NULL;
+	return pool;
+}
+
+
+intlist intlist_pool_cons( intlist_pool pool, int first, intlist next )
+{
+	intlist new = pool->freelist;
+	if( new != NULL )
+	{
+		pool->freelist = new->next;
+	} else
+	{
+		if( pool->nused == SLABCELLS )
+		{
+			slab s = NEW(slab);
+			assert( s != NULL );
+			s->next = pool->slabs;
+			pool->slabs = s;
+			pool->nused = 0;
+		}
+		new = &pool->slabs->cell[pool->nused++];
+	}
+	new->first = first;
+	new->refs = 1;
+	new->next = next;
+	return new;
+}
+
+
+/*
+ * free_intlist_to_pool( pool, p );
+ *	Give all of p's cells back to pool, for reuse by later conses:
+ *	one pass to find p's last cell, then p is spliced onto the
+ *	free list whole.
+ */
+void free_intlist_to_pool( intlist_pool pool, intlist p )
+{
+	if( p == NULL )
+	{
+		return;
+	}
+	intlist last = p;
+	while( last->next != NULL )
+	{
+		last = last->next;
+	}
+	last->next = pool->freelist;
+	pool->freelist = p;
+}
+
+
+void free_intlist_pool( intlist_pool pool )
+{
+	slab s = pool->slabs;
+	while( s != NULL )
+	{
+		slab sn = s->next;
+		free( s );
+		s = sn;
+	}
+	free( pool );
+}
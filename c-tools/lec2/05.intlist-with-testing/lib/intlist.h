@@ -5,6 +5,7 @@
 typedef struct intlist *intlist;
 struct intlist {
 	int	first;
+	int	refs;		/* references to this cell, for release_intlist() */
 	intlist	next;
 };
 
@@ -18,12 +19,69 @@ typedef enum {
 typedef void (*foreach_intlist_callback)( int, void * );
 
 
+struct strbuf;		/* see strbuf.h */
+
 #define intlist_nil() ((intlist)NULL)
 
 extern intlist intlist_cons( int first, intlist next );
 extern kind_of_intlist intlist_kind( intlist this );
 extern void get_intlist_cons( intlist this, int * first, intlist * next );
+extern void append_intlist( struct strbuf * b, intlist p );
 extern void print_intlist( FILE * f, intlist p );
+extern char * intlist_string( intlist p );
 extern void sprint_intlist( char * s, intlist p );
 extern void foreach_intlist( foreach_intlist_callback cb, void * data, intlist p );
 extern void free_intlist( intlist p );
+
+/*
+ * Ordering operations.  These relink (or rewrite) the cells of their
+ * arguments in place and return the resulting list, so the arguments
+ * mustn't share cells with other lists.  sort_intlist() is
+ * mergesort_intlist() for short lists and radixsort_intlist() for long
+ * ones; merge_intlist() merges two sorted lists, and dedupe_intlist()
+ * frees all but the first of each run of equal elements (use it on
+ * malloc()d lists, not pool lists).
+ */
+
+extern intlist mergesort_intlist( intlist p );
+extern intlist radixsort_intlist( intlist p );
+extern intlist sort_intlist( intlist p );
+extern intlist merge_intlist( intlist a, intlist b );
+extern intlist dedupe_intlist( intlist p );
+
+
+/*
+ * intlist_pool: an allocation context for intlist cells.  Cells come
+ * from big slabs, cells given back go on a free list to be reused,
+ * and freeing the pool releases all its cells (every list built in
+ * it) at once.  Don't mix pool cells with free_intlist() or malloc'd
+ * cells with free_intlist_to_pool().
+ */
+
+typedef struct intlist_pool *intlist_pool;
+
+extern intlist_pool new_intlist_pool( void );
+extern intlist intlist_pool_cons( intlist_pool pool, int first, intlist next );
+extern void free_intlist_to_pool( intlist_pool pool, intlist p );
+extern void free_intlist_pool( intlist_pool pool );
+
+
+/*
+ * Persistent (reference counted) use: every cell starts with one
+ * reference, held by whoever consed it.  intlist_share() adds another
+ * reference to a list, intlist_cons() takes over its caller's
+ * reference to next, and release_intlist() drops one reference,
+ * freeing the cells that nobody else refers to.  So two lists can
+ * share a tail without copying it:
+ *
+ *	a = intlist_cons( 1, intlist_share( t ) );
+ *	b = intlist_cons( 2, t );
+ *	release_intlist( a );		// frees a's cell only
+ *	release_intlist( b );		// frees b's cell and t
+ *
+ * Don't mix release_intlist() with free_intlist() or pool lists,
+ * and use a list from one thread at a time.
+ */
+
+extern intlist intlist_share( intlist p );
+extern void release_intlist( intlist p );
@@ -0,0 +1,189 @@
+/*
+ * growable array of integers: the implementation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "strbuf.h"
+#include "intlist.h"
+#include "intvec.h"
+
+
+#define NEW(t) ((t)malloc(sizeof(struct t)))
+
+#define INITCAP	16
+
+
+intvec new_intvec( void )
+{
+	intvec p = NEW(intvec);
+	assert( p != NULL );
+	p->v = NULL;
+	p->n = 0;
+	p->cap = 0;
+	return p;
+}
+
+
+/*
+ * intvec_reserve( p, extra );
+ *	Make sure p has room for extra more elements, at least doubling
+ *	its capacity when it has to grow, so pushes are amortized O(1).
+ */
+void intvec_reserve( intvec p, long extra )
+{
+	if( p->n + extra <= p->cap )
+	{
+		return;
+	}
+	long cap = p->cap > 0 ? p->cap * 2 : INITCAP;
+	if( cap < p->n + extra )
+	{
+		cap = p->n + extra;
+	}
+	p->v = realloc( p->v, cap * sizeof(int) );
+	assert( p->v != NULL );
+	p->cap = cap;
+}
+
+
+void intvec_push( intvec p, int x )
+{
+	if( p->n == p->cap )
+	{
+		intvec_reserve( p, 1 );
+	}
+	p->v[p->n++] = x;
+}
+
+
+void intvec_append( intvec p, int *a, long n )
+{
+	intvec_reserve( p, n );
+	memcpy( p->v + p->n, a, n * sizeof(int) );
+	p->n += n;
+}
+
+
+/*
+ * append_intvec( b, p );
+ *	Append p, in "[ 1,2,3 ]" form, to string builder b.
+ */
+void append_intvec( strbuf b, intvec p )
+{
+	strbuf_addstr( b, "[ " );
+	long i;
+	for( i = 0; i < p->n; i++ )
+	{
+		if( i > 0 )
+		{
+			strbuf_addchar( b, ',' );
+		}
+		strbuf_addint( b, p->v[i] );
+	}
+	strbuf_addstr( b, " ]" );
+}
+
+
+#define PRINTBUF	65536	/* print_intvec() writes this much at a time */
+
+void print_intvec( FILE *f, intvec p )
+{
+	strbuf b = new_strbuf();
+	strbuf_addstr( b, "[ " );
+	long i;
+	for( i = 0; i < p->n; i++ )
+	{
+		if( i > 0 )
+		{
+			strbuf_addchar( b, ',' );
+		}
+		strbuf_addint( b, p->v[i] );
+		if( strbuf_len(b) >= PRINTBUF )
+		{
+			fwrite( strbuf_str(b), 1, strbuf_len(b), f );
+			strbuf_clear( b );
+		}
+	}
+	strbuf_addstr( b, " ]" );
+	fwrite( strbuf_str(b), 1, strbuf_len(b), f );
+	free_strbuf( b );
+}
+
+
+/*
+ * char *s = intvec_string( p );
+ *	Return p in "[ 1,2,3 ]" form as a malloc()d string.
+ */
+char *intvec_string( intvec p )
+{
+	strbuf b = new_strbuf();
+	append_intvec( b, p );
+	return strbuf_finish( b );
+}
+
+
+/*
+ * sprint_intvec( s, p );
+ *	Write p in "[ 1,2,3 ]" form into s, which must be big enough:
+ *	prefer intvec_string() or append_intvec().
+ */
+void sprint_intvec( char *s, intvec p )
+{
+	strbuf b = new_strbuf();
+	append_intvec( b, p );
+	memcpy( s, strbuf_str(b), strbuf_len(b) + 1 );
+	free_strbuf( b );
+}
+
+
+void foreach_intvec( foreach_intvec_callback cb, void *data, intvec p )
+{
+	long i;
+	for( i = 0; i < p->n; i++ )
+	{
+		(*cb)( p->v[i], data );
+	}
+}
+
+
+void free_intvec( intvec p )
+{
+	free( p->v );
+	free( p );
+}
+
+
+/*
+ * intvec p = intlist_to_intvec( l );
+ *	Return a new intvec of l's elements, in the same order.
+ */
+intvec intlist_to_intvec( intlist l )
+{
+	intvec p = new_intvec();
+	for( ; l != NULL; l = l->next )
+	{
+		intvec_push( p, l->first );
+	}
+	return p;
+}
+
+
+/*
+ * intlist l = intvec_to_intlist( p );
+ *	Return a new intlist of p's elements, in the same order
+ *	(built back to front, so it's one cons per element).
+ */
+intlist intvec_to_intlist( intvec p )
+{
+	intlist l = intlist_nil();
+	long i;
+	for( i = p->n-1; i >= 0; i-- )
+	{
+		l = intlist_cons( p->v[i], l );
+	}
+	return l;
+}
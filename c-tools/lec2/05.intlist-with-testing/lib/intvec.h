@@ -0,0 +1,34 @@
+/*
+ * intvec: a growable array of integers, for programs that only append
+ *	   and scan (where a linked list is slowest): amortized O(1)
+ *	   push, bulk append, and the same print/foreach/free style as
+ *	   intlist, with conversions to and from intlists.
+ */
+
+typedef struct intvec *intvec;
+struct intvec {
+	int *	v;		/* the elements, v[0..n-1] */
+	long	n;
+	long	cap;		/* room for this many */
+};
+
+
+typedef void (*foreach_intvec_callback)( int, void * );
+
+struct strbuf;		/* see strbuf.h */
+
+#define intvec_len(p)		((p)->n)
+#define intvec_get(p,i)		((p)->v[i])
+
+extern intvec new_intvec( void );
+extern void intvec_reserve( intvec p, long extra );
+extern void intvec_push( intvec p, int x );
+extern void intvec_append( intvec p, int * a, long n );
+extern void append_intvec( struct strbuf * b, intvec p );
+extern void print_intvec( FILE * f, intvec p );
+extern char * intvec_string( intvec p );
+extern void sprint_intvec( char * s, intvec p );
+extern void foreach_intvec( foreach_intvec_callback cb, void * data, intvec p );
+extern void free_intvec( intvec p );
+extern intvec intlist_to_intvec( intlist l );
+extern intlist intvec_to_intlist( intvec p );
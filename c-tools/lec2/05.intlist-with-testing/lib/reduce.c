@@ -0,0 +1,279 @@
+/*
+ * reductions over ints, intlists and chunklists: the implementation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <assert.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "intlist.h"
+#include "chunklist.h"
+#include "reduce.h"
+
+
+#define BLOCK	1024	/* ints per kernel call: m2 rereads the block */
+
+
+void init_intsummary( intsummary *s )
+{
+	s->count = 0;
+	s->sum = 0;
+	s->min = INT_MAX;
+	s->max = INT_MIN;
+	s->m2 = 0;
+}
+
+
+/*
+ * merge_intsummary( s, t );
+ *	Fold summary t into s.
+ */
+void merge_intsummary( intsummary *s, intsummary *t )
+{
+	if( t->count == 0 )
+	{
+		return;
+	}
+	if( s->count > 0 )
+	{
+		double delta = (double)t->sum / t->count -
+			       (double)s->sum / s->count;
+		s->m2 += t->m2 + delta * delta *
+			 ((double)s->count * t->count / (s->count + t->count));
+	} else
+	{
+		s->m2 = t->m2;
+	}
+	s->count += t->count;
+	s->sum += t->sum;
+	if( t->min < s->min )
+	{
+		s->min = t->min;
+	}
+	if( t->max > s->max )
+	{
+		s->max = t->max;
+	}
+}
+
+
+#ifdef __SSE2__
+
+/* the SSE2 kernels: 4 ints at a time */
+
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#define MIN4(a,b)	_mm_min_epi32( a, b )
+#define MAX4(a,b)	_mm_max_epi32( a, b )
+#else
+static inline __m128i MIN4( __m128i a, __m128i b )
+{
+	__m128i gt = _mm_cmpgt_epi32( a, b );
+	return _mm_or_si128( _mm_and_si128( gt, b ), _mm_andnot_si128( gt, a ) );
+}
+static inline __m128i MAX4( __m128i a, __m128i b )
+{
+	__m128i gt = _mm_cmpgt_epi32( a, b );
+	return _mm_or_si128( _mm_and_si128( gt, a ), _mm_andnot_si128( gt, b ) );
+}
+#endif
+
+
+/*
+ * block( v, n, &t );
+ *	Summarise v[0..n-1] (n > 0) into a fresh summary t.
+ */
+static void block( int *v, long n, intsummary *t )
+{
+	__m128i sum = _mm_setzero_si128();	/* 2 x int64 */
+	__m128i mn = _mm_set1_epi32( INT_MAX );
+	__m128i mx = _mm_set1_epi32( INT_MIN );
+	long i;
+	for( i = 0; i + 4 <= n; i += 4 )
+	{
+		__m128i x = _mm_loadu_si128( (__m128i *)(v+i) );
+		__m128i sign = _mm_srai_epi32( x, 31 );
+		sum = _mm_add_epi64( sum, _mm_unpacklo_epi32( x, sign ) );
+		sum = _mm_add_epi64( sum, _mm_unpackhi_epi32( x, sign ) );
+		mn = MIN4( mn, x );
+		mx = MAX4( mx, x );
+	}
+	int64_t s2[2];
+	int m4[4], x4[4];
+	_mm_storeu_si128( (__m128i *)s2, sum );
+	_mm_storeu_si128( (__m128i *)m4, mn );
+	_mm_storeu_si128( (__m128i *)x4, mx );
+	t->sum = s2[0] + s2[1];
+	t->min = m4[0];
+	t->max = x4[0];
+	int j;
+	for( j = 1; j < 4; j++ )
+	{
+		if( m4[j] < t->min )
+		{
+			t->min = m4[j];
+		}
+		if( x4[j] > t->max )
+		{
+			t->max = x4[j];
+		}
+	}
+	for( ; i < n; i++ )
+	{
+		t->sum += v[i];
+		if( v[i] < t->min )
+		{
+			t->min = v[i];
+		}
+		if( v[i] > t->max )
+		{
+			t->max = v[i];
+		}
+	}
+	t->count = n;
+
+	double mean = (double)t->sum / n;
+	__m128d vmean = _mm_set1_pd( mean );
+	__m128d m2 = _mm_setzero_pd();
+	for( i = 0; i + 2 <= n; i += 2 )
+	{
+		__m128i x = _mm_loadl_epi64( (__m128i *)(v+i) );
+		__m128d d = _mm_sub_pd( _mm_cvtepi32_pd( x ), vmean );
+		m2 = _mm_add_pd( m2, _mm_mul_pd( d, d ) );
+	}
+	double d2[2];
+	_mm_storeu_pd( d2, m2 );
+	t->m2 = d2[0] + d2[1];
+	for( ; i < n; i++ )
+	{
+		double d = v[i] - mean;
+		t->m2 += d * d;
+	}
+}
+
+#else
+
+/* the plain C kernel */
+static void block( int *v, long n, intsummary *t )
+{
+	t->count = n;
+	t->sum = 0;
+	t->min = INT_MAX;
+	t->max = INT_MIN;
+	long i;
+	for( i = 0; i < n; i++ )
+	{
+		t->sum += v[i];
+		if( v[i] < t->min )
+		{
+			t->min = v[i];
+		}
+		if( v[i] > t->max )
+		{
+			t->max = v[i];
+		}
+	}
+	double mean = (double)t->sum / n;
+	t->m2 = 0;
+	for( i = 0; i < n; i++ )
+	{
+		double d = v[i] - mean;
+		t->m2 += d * d;
+	}
+}
+
+#endif
+
+
+void summarise_ints( intsummary *s, int *v, long n )
+{
+	while( n > 0 )
+	{
+		long len = n < BLOCK ? n : BLOCK;
+		intsummary t;
+		block( v, len, &t );
+		merge_intsummary( s, &t );
+		v += len;
+		n -= len;
+	}
+}
+
+
+void summarise_intlist( intsummary *s, intlist l )
+{
+	int buf[BLOCK];
+	while( l != NULL )
+	{
+		int n = 0;
+		for( ; l != NULL && n < BLOCK; l = l->next )
+		{
+			buf[n++] = l->first;
+		}
+		summarise_ints( s, buf, n );
+	}
+}
+
+
+void summarise_chunklist( intsummary *s, chunklist l )
+{
+	for( ; l.c != NULL; l.n = l.c->nextn, l.c = l.c->next )
+	{
+		summarise_ints( s, l.c->v, l.n );
+	}
+}
+
+
+double intsummary_mean( intsummary *s )
+{
+	return s->count > 0 ? (double)s->sum / s->count : 0;
+}
+
+
+/* the population variance */
+double intsummary_variance( intsummary *s )
+{
+	return s->count > 0 ? s->m2 / s->count : 0;
+}
+
+
+void histogram_ints( long *hist, int nbuckets, int *v, long n )
+{
+	assert( nbuckets > 0 );
+	unsigned top = nbuckets - 1;
+	long i;
+	for( i = 0; i < n; i++ )
+	{
+		int x = v[i];
+		unsigned b = x < 0 ? 0 : (unsigned)x > top ? top : (unsigned)x;
+		hist[b]++;
+	}
+}
+
+
+void histogram_intlist( long *hist, int nbuckets, intlist l )
+{
+	int buf[BLOCK];
+	while( l != NULL )
+	{
+		int n = 0;
+		for( ; l != NULL && n < BLOCK; l = l->next )
+		{
+			buf[n++] = l->first;
+		}
+		histogram_ints( hist, nbuckets, buf, n );
+	}
+}
+
+
+void histogram_chunklist( long *hist, int nbuckets, chunklist l )
+{
+	for( ; l.c != NULL; l.n = l.c->nextn, l.c = l.c->next )
+	{
+		histogram_ints( hist, nbuckets, l.c->v, l.n );
+	}
+}
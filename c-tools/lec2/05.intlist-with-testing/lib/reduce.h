@@ -0,0 +1,44 @@
+/*
+ * reduce: summary statistics (count, sum, min, max, mean, variance)
+ *	   and histograms over arrays of ints, intlists and chunklists.
+ *
+ *	   The array kernels use SSE2 where the compiler targets it
+ *	   (always, on x86-64), with a plain C fallback elsewhere.  The
+ *	   list versions feed contiguous runs of ints (a chunk at a time,
+ *	   or a small buffer's worth of intlist cells) to the kernels.
+ *
+ *	   An intsummary accumulates: initialise it with
+ *	   init_intsummary(), then summarise any number of arrays or lists
+ *	   into it.  The sum is 64-bit, and the variance is tracked as the
+ *	   sum of squared deviations from the mean (m2), combining blocks
+ *	   with Chan et al's formula, so it doesn't overflow or lose
+ *	   precision on big inputs.
+ */
+
+#include <stdint.h>
+
+typedef struct {
+	long	count;
+	int64_t	sum;
+	int	min;		/* INT_MAX while count == 0 */
+	int	max;		/* INT_MIN while count == 0 */
+	double	m2;		/* sum of (x - mean)^2 */
+} intsummary;
+
+
+extern void init_intsummary( intsummary * s );
+extern void summarise_ints( intsummary * s, int * v, long n );
+extern void summarise_intlist( intsummary * s, intlist l );
+extern void summarise_chunklist( intsummary * s, chunklist l );
+extern void merge_intsummary( intsummary * s, intsummary * t );
+extern double intsummary_mean( intsummary * s );
+extern double intsummary_variance( intsummary * s );
+
+/*
+ * histograms: hist[i] += the number of elements equal to i, for
+ * 0 <= i < nbuckets; elements < 0 are counted in hist[0] and
+ * elements >= nbuckets in hist[nbuckets-1].
+ */
+extern void histogram_ints( long * hist, int nbuckets, int * v, long n );
+extern void histogram_intlist( long * hist, int nbuckets, intlist l );
+extern void histogram_chunklist( long * hist, int nbuckets, chunklist l );
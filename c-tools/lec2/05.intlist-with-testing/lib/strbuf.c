@@ -0,0 +1,139 @@
+/*
+ * growable string builder: the implementation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "strbuf.h"
+
+
+#define NEW(t) ((t)malloc(sizeof(struct t)))
+
+#define INITCAP	64
+
+
+strbuf new_strbuf( void )
+{
+	strbuf b = NEW(strbuf);
+	assert( b != NULL );
+	b->cap = INITCAP;
+	b->s = malloc( b->cap + 1 );
+	assert( b->s != NULL );
+	b->s[0] = '\0';
+	b->len = 0;
+	return b;
+}
+
+
+/*
+ * strbuf_reserve( b, extra );
+ *	Make sure b has room for extra more characters.
+ */
+void strbuf_reserve( strbuf b, size_t extra )
+{
+	if( b->len + extra <= b->cap )
+	{
+		return;
+	}
+	size_t cap = b->cap * 2;
+	if( cap < b->len + extra )
+	{
+		cap = b->len + extra;
+	}
+	b->s = realloc( b->s, cap + 1 );
+	assert( b->s != NULL );
+	b->cap = cap;
+}
+
+
+void strbuf_addchar( strbuf b, char c )
+{
+	strbuf_reserve( b, 1 );
+	b->s[b->len++] = c;
+	b->s[b->len] = '\0';
+}
+
+
+void strbuf_addmem( strbuf b, char *p, size_t len )
+{
+	strbuf_reserve( b, len );
+	memcpy( b->s + b->len, p, len );
+	b->len += len;
+	b->s[b->len] = '\0';
+}
+
+
+void strbuf_addstr( strbuf b, char *s )
+{
+	strbuf_addmem( b, s, strlen(s) );
+}
+
+
+static const char digitpairs[201] =
+	"00010203040506070809"
+	"10111213141516171819"
+	"20212223242526272829"
+	"30313233343536373839"
+	"40414243444546474849"
+	"50515253545556575859"
+	"60616263646566676869"
+	"70717273747576777879"
+	"80818283848586878889"
+	"90919293949596979899";
+
+void strbuf_addint( strbuf b, int n )
+{
+	char tmp[12];			/* "-2147483648" */
+	char *p = tmp + sizeof(tmp);
+	unsigned u = n < 0 ? 0u - (unsigned)n : (unsigned)n;
+	while( u >= 100 )
+	{
+		unsigned r = u % 100;
+		u /= 100;
+		p -= 2;
+		memcpy( p, digitpairs + 2*r, 2 );
+	}
+	if( u >= 10 )
+	{
+		p -= 2;
+		memcpy( p, digitpairs + 2*u, 2 );
+	} else
+	{
+		*--p = '0' + u;
+	}
+	if( n < 0 )
+	{
+		*--p = '-';
+	}
+	strbuf_addmem( b, p, tmp + sizeof(tmp) - p );
+}
+
+
+void strbuf_clear( strbuf b )
+{
+	b->len = 0;
+	b->s[0] = '\0';
+}
+
+
+/*
+ * char *s = strbuf_finish( b );
+ *	Free b but not its string, which is returned: the caller
+ *	must free() it.
+ */
+char *strbuf_finish( strbuf b )
+{
+	char *s = b->s;
+	free( b );
+	return s;
+}
+
+
+void free_strbuf( strbuf b )
+{
+	free( b->s );
+	free( b );
+}
@@ -0,0 +1,27 @@
+/*
+ * strbuf: a growable string builder.  It tracks its length, doubles
+ *	   its buffer when full (so appending n characters costs O(n)
+ *	   overall), and always keeps the string '\0' terminated.
+ *	   strbuf_addint() converts two decimal digits at a time.
+ */
+
+typedef struct strbuf *strbuf;
+struct strbuf {
+	char *	s;
+	size_t	len;		/* strlen(s) */
+	size_t	cap;		/* s has room for cap characters plus '\0' */
+};
+
+
+extern strbuf new_strbuf( void );
+extern void strbuf_reserve( strbuf b, size_t extra );
+extern void strbuf_addchar( strbuf b, char c );
+extern void strbuf_addmem( strbuf b, char * p, size_t len );
+extern void strbuf_addstr( strbuf b, char * s );
+extern void strbuf_addint( strbuf b, int n );
+extern void strbuf_clear( strbuf b );
+extern char * strbuf_finish( strbuf b );
+extern void free_strbuf( strbuf b );
+
+#define strbuf_str(b)	((b)->s)
+#define strbuf_len(b)	((b)->len)
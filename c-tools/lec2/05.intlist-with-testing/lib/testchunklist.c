@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <testutils.h>
+#include "chunklist.h"
+
+
+void sumcb( int el, void *sumsofar )
+{
+	int *data = (int *)sumsofar;
+	(*data) += el;
+}
+
+
+int main( void )
+{
+	chunklist l = chunklist_nil();
+	testcond( chunklist_kind( l ) == chunklist_is_nil,
+		"kind(nil) == nil" );
+
+	l = chunklist_cons( 100, l );
+	testcond( chunklist_kind( l ) == chunklist_is_cons,
+		"kind([100]) == cons" );
+
+	chunklist tail;
+	int head;
+	get_chunklist_cons( l, &head, &tail );
+	testint( head, 100, "head([100]) == 100" );
+	testcond( chunklist_kind( tail ) == chunklist_is_nil,
+		"kind(tail([100])) == nil" );
+
+	l = chunklist_cons( 200, l );
+	get_chunklist_cons( l, &head, &tail );
+	testint( head, 200, "head([200,100]) == 200" );
+	get_chunklist_cons( tail, &head, &tail );
+	testint( head, 100, "head(tail([200,100])) == 100" );
+
+	l = chunklist_cons( 300, l );
+	l = chunklist_cons( 400, l );
+
+	char result[1000];
+	sprint_chunklist( result, l );
+	teststring( result, "[ 400,300,200,100 ]", "sprint test" );
+
+	int sum = 0;
+	foreach_chunklist( sumcb, (void *)&sum, l );
+	testint( sum, 1000, "sum 1000" );
+
+	/* cons onto a shared tail: the original list must be unchanged */
+	chunklist tail2;
+	get_chunklist_cons( l, &head, &tail2 );
+	chunklist b = chunklist_cons( 500, tail2 );
+	sprint_chunklist( result, b );
+	teststring( result, "[ 500,300,200,100 ]", "cons onto shared tail" );
+	sprint_chunklist( result, l );
+	teststring( result, "[ 400,300,200,100 ]", "original unchanged" );
+	free( b.c );	/* b's own chunk: the rest is l's */
+
+	free_chunklist( l );
+
+	/* spill over several chunks */
+	l = chunklist_nil();
+	int i;
+	for( i = 1; i <= 1000; i++ )
+	{
+		l = chunklist_cons( i, l );
+	}
+	sum = 0;
+	foreach_chunklist( sumcb, (void *)&sum, l );
+	testint( sum, 500500, "sum(1..1000) == 500500" );
+
+	bool inorder = true;
+	chunklist p = l;
+	for( i = 1000; i >= 1; i-- )
+	{
+		get_chunklist_cons( p, &head, &p );
+		inorder = inorder && head == i;
+	}
+	testcond( inorder && chunklist_kind( p ) == chunklist_is_nil,
+		"1000-element list walks 1000..1 then nil" );
+
+	free_chunklist( l );
+
+	return(0);
+}
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include <testutils.h>
+#include "strbuf.h"
+#include "intlist.h"
+#include "intvec.h"
+
+
+void sumcb( int el, void *sumsofar )
+{
+	int *data = (int *)sumsofar;
+	(*data) += el;
+}
+
+
+int main( void )
+{
+	intvec v = new_intvec();
+	testint( intvec_len(v), 0, "new intvec is empty" );
+
+	intvec_push( v, 100 );
+	intvec_push( v, 200 );
+	intvec_push( v, 300 );
+	intvec_push( v, 400 );
+	testint( intvec_len(v), 4, "4 pushed" );
+	testint( intvec_get(v,0), 100, "v[0] == 100" );
+	testint( intvec_get(v,3), 400, "v[3] == 400" );
+
+	char result[1000];
+	sprint_intvec( result, v );
+	teststring( result, "[ 100,200,300,400 ]", "sprint test" );
+
+	int sum = 0;
+	foreach_intvec( sumcb, (void *)&sum, v );
+	testint( sum, 1000, "sum 1000" );
+
+	int more[] = { 1, 2, 3 };
+	intvec_append( v, more, 3 );
+	char *s = intvec_string( v );
+	teststring( s, "[ 100,200,300,400,1,2,3 ]", "bulk append" );
+	free( s );
+
+	intlist l = intvec_to_intlist( v );
+	sprint_intlist( result, l );
+	teststring( result, "[ 100,200,300,400,1,2,3 ]", "to intlist, same order" );
+	intvec w = intlist_to_intvec( l );
+	sprint_intvec( result, w );
+	teststring( result, "[ 100,200,300,400,1,2,3 ]", "and back again" );
+	free_intlist( l );
+	free_intvec( w );
+	free_intvec( v );
+
+	/* grow a lot */
+	v = new_intvec();
+	int i;
+	for( i = 0; i < 100000; i++ )
+	{
+		intvec_push( v, i );
+	}
+	bool ok = intvec_len(v) == 100000;
+	for( i = 0; i < 100000 && ok; i++ )
+	{
+		ok = intvec_get(v,i) == i;
+	}
+	testcond( ok, "100000 pushes, all in place" );
+	free_intvec( v );
+
+	return(0);
+}
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 
 #include <testutils.h>
+#include "strbuf.h"
 #include "intlist.h"
 
 
@@ -50,5 +51,139 @@ int main( void )
 
 	free_intlist( l );
 
+	/* the same again, in a pool */
+	intlist_pool pool = new_intlist_pool();
+	l = intlist_nil();
+	int i;
+	for( i = 1; i <= 10000; i++ )
+	{
+		l = intlist_pool_cons( pool, i, l );
+	}
+	sum = 0;
+	foreach_intlist( sumcb, (void *)&sum, l );
+	testint( sum, 50005000, "pool: sum(1..10000) == 50005000" );
+
+	intlist first = l;
+	free_intlist_to_pool( pool, l );
+	l = intlist_pool_cons( pool, 42, intlist_nil() );
+	testcond( l == first, "pool: freed cells are reused" );
+	l = intlist_pool_cons( pool, 43, l );
+	sprint_intlist( result, l );
+	teststring( result, "[ 43,42 ]", "pool: sprint reused cells" );
+
+	char *str = intlist_string( l );
+	teststring( str, "[ 43,42 ]", "intlist_string" );
+	free( str );
+	str = intlist_string( intlist_nil() );
+	teststring( str, "[  ]", "intlist_string(nil)" );
+	free( str );
+
+	/* a big list: intlist_string and print_intlist must agree */
+	intlist big = intlist_nil();
+	for( i = 0; i < 100000; i++ )
+	{
+		big = intlist_pool_cons( pool, i % 10, big );
+	}
+	str = intlist_string( big );
+	testint( strlen(str), 2 * 100000 - 1 + 4, "intlist_string(100000 digits) length" );
+	FILE *tmp = tmpfile();
+	print_intlist( tmp, big );
+	rewind( tmp );
+	char *printed = malloc( strlen(str) + 2 );
+	size_t got = fread( printed, 1, strlen(str) + 1, tmp );
+	printed[got] = '\0';
+	fclose( tmp );
+	teststring( printed, str, "print_intlist == intlist_string" );
+	free( printed );
+	free( str );
+
+	free_intlist_pool( pool );
+
+	/* persistent lists: two branches sharing one tail */
+	intlist t = intlist_cons( 3, intlist_cons( 2, intlist_cons( 1, intlist_nil() ) ) );
+	intlist a = intlist_cons( 10, intlist_share( t ) );
+	intlist b = intlist_cons( 20, t );
+	testint( t->refs, 2, "shared tail has 2 refs" );
+	sprint_intlist( result, a );
+	teststring( result, "[ 10,3,2,1 ]", "branch a" );
+	release_intlist( a );
+	testint( t->refs, 1, "releasing a leaves the tail 1 ref" );
+	sprint_intlist( result, b );
+	teststring( result, "[ 20,3,2,1 ]", "branch b intact after releasing a" );
+
+	/* 1000 branches off b's tail, released in turn */
+	intlist branch[1000];
+	for( i = 0; i < 1000; i++ )
+	{
+		branch[i] = intlist_cons( i, intlist_share( b ) );
+	}
+	testint( b->refs, 1001, "b has 1001 refs" );
+	for( i = 0; i < 1000; i++ )
+	{
+		release_intlist( branch[i] );
+	}
+	testint( b->refs, 1, "b back to 1 ref" );
+	release_intlist( b );
+
+	/* sorting, merging and deduping */
+	int data[] = { 5, -3, 9, 5, 0, -3, 12, 5, 1000000, -1000000, 7 };
+	intlist m = intlist_nil();
+	intlist r = intlist_nil();
+	for( i = 0; i < 11; i++ )
+	{
+		m = intlist_cons( data[i], m );
+		r = intlist_cons( data[i], r );
+	}
+	m = mergesort_intlist( m );
+	sprint_intlist( result, m );
+	teststring( result, "[ -1000000,-3,-3,0,5,5,5,7,9,12,1000000 ]", "mergesort" );
+	r = radixsort_intlist( r );
+	sprint_intlist( result, r );
+	teststring( result, "[ -1000000,-3,-3,0,5,5,5,7,9,12,1000000 ]", "radixsort" );
+	m = dedupe_intlist( m );
+	sprint_intlist( result, m );
+	teststring( result, "[ -1000000,-3,0,5,7,9,12,1000000 ]", "dedupe" );
+
+	intlist odd = intlist_nil(), even = intlist_nil();
+	for( i = 9; i >= 0; i-- )
+	{
+		if( i % 2 )
+		{
+			odd = intlist_cons( i, odd );
+		} else
+		{
+			even = intlist_cons( i, even );
+		}
+	}
+	intlist all = merge_intlist( odd, even );
+	sprint_intlist( result, all );
+	teststring( result, "[ 0,1,2,3,4,5,6,7,8,9 ]", "merge odds and evens" );
+	free_intlist( all );
+	free_intlist( m );
+	free_intlist( r );
+
+	/* a big pseudo-random list: both sorts agree, and are sorted */
+	intlist big1 = intlist_nil(), big2 = intlist_nil();
+	unsigned x = 12345;
+	for( i = 0; i < 100000; i++ )
+	{
+		x = x * 1103515245 + 12345;
+		big1 = intlist_cons( (int)x, big1 );
+		big2 = intlist_cons( (int)x, big2 );
+	}
+	big1 = sort_intlist( big1 );
+	big2 = mergesort_intlist( big2 );
+	bool same = true, sorted = true;
+	intlist p1, p2;
+	for( p1 = big1, p2 = big2; p1 != NULL && p2 != NULL; p1 = p1->next, p2 = p2->next )
+	{
+		same = same && p1->first == p2->first;
+		sorted = sorted && (p1->next == NULL || p1->first <= p1->next->first);
+	}
+	testcond( same && p1 == NULL && p2 == NULL, "big: radix and merge sorts agree" );
+	testcond( sorted, "big: sorted" );
+	free_intlist( big1 );
+	free_intlist( big2 );
+
 	return(0);
 }
@@ -0,0 +1,92 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <math.h>
+
+#include <testutils.h>
+#include "intlist.h"
+#include "chunklist.h"
+#include "reduce.h"
+
+
+int main( void )
+{
+	intsummary s;
+	init_intsummary( &s );
+	testlong( s.count, 0, "empty: count == 0" );
+	testdouble( intsummary_mean( &s ), 0, "empty: mean == 0" );
+
+	int v[] = { 2, 4, 4, 4, 5, 5, 7, 9 };
+	summarise_ints( &s, v, 8 );
+	testlong( s.count, 8, "count(v) == 8" );
+	testlong( s.sum, 40, "sum(v) == 40" );
+	testint( s.min, 2, "min(v) == 2" );
+	testint( s.max, 9, "max(v) == 9" );
+	testdouble( intsummary_mean( &s ), 5, "mean(v) == 5" );
+	testdouble( intsummary_variance( &s ), 4, "variance(v) == 4" );
+
+	/* the sum mustn't overflow an int */
+	int big[5] = { INT_MAX, INT_MAX, INT_MAX, INT_MAX, INT_MIN };
+	init_intsummary( &s );
+	summarise_ints( &s, big, 5 );
+	testlong( s.sum, 3L * INT_MAX - 1, "sum(big) == 3*INT_MAX-1" );
+	testint( s.min, INT_MIN, "min(big) == INT_MIN" );
+	testint( s.max, INT_MAX, "max(big) == INT_MAX" );
+
+	/* 1..10000 as an array, an intlist and a chunklist */
+	int n = 10000;
+	int *a = malloc( n * sizeof(int) );
+	intlist l = intlist_nil();
+	chunklist c = chunklist_nil();
+	int i;
+	for( i = 0; i < n; i++ )
+	{
+		a[i] = i + 1;
+		l = intlist_cons( i + 1, l );
+		c = chunklist_cons( i + 1, c );
+	}
+	intsummary sa, sl, sc;
+	init_intsummary( &sa );
+	init_intsummary( &sl );
+	init_intsummary( &sc );
+	summarise_ints( &sa, a, n );
+	summarise_intlist( &sl, l );
+	summarise_chunklist( &sc, c );
+	testlong( sa.sum, 50005000, "array: sum(1..10000) == 50005000" );
+	testlong( sl.sum, 50005000, "intlist: sum(1..10000) == 50005000" );
+	testlong( sc.sum, 50005000, "chunklist: sum(1..10000) == 50005000" );
+	testcond( sa.min == 1 && sl.min == 1 && sc.min == 1, "all: min == 1" );
+	testcond( sa.max == n && sl.max == n && sc.max == n, "all: max == 10000" );
+
+	/* variance of 1..n is (n^2-1)/12 */
+	double want = ((double)n * n - 1) / 12;
+	testcond( fabs( intsummary_variance( &sa ) - want ) < 1e-6 * want,
+		"array: variance(1..10000) == (n^2-1)/12" );
+	testcond( fabs( intsummary_variance( &sl ) - want ) < 1e-6 * want,
+		"intlist: variance(1..10000) == (n^2-1)/12" );
+	testcond( fabs( intsummary_variance( &sc ) - want ) < 1e-6 * want,
+		"chunklist: variance(1..10000) == (n^2-1)/12" );
+
+	long hist[4] = { 0, 0, 0, 0 };
+	int h[] = { -5, 0, 1, 1, 2, 3, 4, 100 };
+	histogram_ints( hist, 4, h, 8 );
+	testcond( hist[0] == 2 && hist[1] == 2 && hist[2] == 1 && hist[3] == 3,
+		"histogram clamps to [0,nbuckets-1]" );
+
+	long hl[10001], hc[10001];
+	memset( hl, 0, sizeof(hl) );
+	memset( hc, 0, sizeof(hc) );
+	histogram_intlist( hl, 10001, l );
+	histogram_chunklist( hc, 10001, c );
+	testcond( hl[0] == 0 && hl[1] == 1 && hl[10000] == 1 &&
+		  memcmp( hl, hc, sizeof(hl) ) == 0,
+		"intlist and chunklist histograms of 1..10000 agree" );
+
+	free( a );
+	free_intlist( l );
+	free_chunklist( c );
+
+	return(0);
+}
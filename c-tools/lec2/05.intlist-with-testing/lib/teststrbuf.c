@@ -0,0 +1,64 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include <testutils.h>
+#include "strbuf.h"
+
+
+int main( void )
+{
+	strbuf b = new_strbuf();
+	teststring( strbuf_str(b), "", "new strbuf is empty" );
+
+	strbuf_addstr( b, "hello" );
+	strbuf_addchar( b, ' ' );
+	strbuf_addmem( b, "world!!!", 5 );
+	teststring( strbuf_str(b), "hello world", "add str, char, mem" );
+	testint( strbuf_len(b), 11, "length 11" );
+
+	strbuf_clear( b );
+	strbuf_addint( b, 0 );
+	strbuf_addchar( b, ',' );
+	strbuf_addint( b, 7 );
+	strbuf_addchar( b, ',' );
+	strbuf_addint( b, -42 );
+	strbuf_addchar( b, ',' );
+	strbuf_addint( b, 100 );
+	strbuf_addchar( b, ',' );
+	strbuf_addint( b, INT_MAX );
+	strbuf_addchar( b, ',' );
+	strbuf_addint( b, INT_MIN );
+	teststring( strbuf_str(b), "0,7,-42,100,2147483647,-2147483648",
+		"addint" );
+
+	/* every int in -100000..100000 agrees with sprintf */
+	bool ok = true;
+	int i;
+	for( i = -100000; i <= 100000 && ok; i++ )
+	{
+		char want[20];
+		sprintf( want, "%d", i );
+		strbuf_clear( b );
+		strbuf_addint( b, i );
+		ok = strcmp( strbuf_str(b), want ) == 0;
+	}
+	testcond( ok, "addint agrees with sprintf" );
+
+	/* grow well past the initial size */
+	strbuf_clear( b );
+	for( i = 0; i < 100000; i++ )
+	{
+		strbuf_addchar( b, 'x' );
+	}
+	testint( strbuf_len(b), 100000, "100000 chars appended" );
+	testint( strlen( strbuf_str(b) ), 100000, "still terminated" );
+
+	char *s = strbuf_finish( b );
+	testcond( s[99999] == 'x' && s[100000] == '\0', "finish keeps the string" );
+	free( s );
+
+	return(0);
+}
@@ -0,0 +1,63 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+
+#include <testutils.h>
+#include "intlist.h"
+#include "chunklist.h"
+#include "reduce.h"
+#include "wordstats.h"
+
+
+int main( void )
+{
+	wordstats w;
+	init_wordstats( &w );
+	char *text = "a\nbb\n\nccc\ndddd";
+	wordstats_buf( &w, text, strlen(text) );
+	testlong( w.s.count, 5, "5 lines, last unterminated" );
+	testlong( w.s.sum, 10, "sum of lengths == 10" );
+	testint( w.s.min, 0, "min length == 0" );
+	testint( w.s.max, 4, "max length == 4" );
+	testcond( w.hist[0] == 1 && w.hist[1] == 1 && w.hist[4] == 1,
+		"histogram of lengths" );
+
+	/* a file of 200000 lines, lengths cycling through 0..99 */
+	char path[] = "/tmp/testwordstatsXXXXXX";
+	int fd = mkstemp( path );
+	FILE *f = fdopen( fd, "w" );
+	char line[128];
+	memset( line, 'x', sizeof(line) );
+	int i;
+	long sum = 0;
+	for( i = 0; i < 200000; i++ )
+	{
+		fwrite( line, 1, i % 100, f );
+		fputc( '\n', f );
+		sum += i % 100;
+	}
+	fclose( f );
+
+	wordstats w1, w4;
+	init_wordstats( &w1 );
+	init_wordstats( &w4 );
+	testcond( wordstats_file( &w1, path, 1 ), "read file, 1 thread" );
+	testcond( wordstats_file( &w4, path, 4 ), "read file, 4 threads" );
+	testlong( w1.s.count, 200000, "1 thread: 200000 lines" );
+	testlong( w1.s.sum, sum, "1 thread: sum of lengths" );
+	testlong( w4.s.count, 200000, "4 threads: 200000 lines" );
+	testlong( w4.s.sum, sum, "4 threads: sum of lengths" );
+	testcond( w4.s.min == 0 && w4.s.max == 99, "4 threads: min 0, max 99" );
+	testcond( memcmp( w1.hist, w4.hist, sizeof(w1.hist) ) == 0,
+		"1 and 4 threads: same histogram" );
+	testlong( w1.hist[WORDSTATS_MAXLEN], 2000 * (100 - WORDSTATS_MAXLEN),
+		"long lines counted in the last bucket" );
+	unlink( path );
+
+	testcond( ! wordstats_file( &w1, "/nonexistent/file", 1 ),
+		"missing file fails" );
+
+	return(0);
+}
@@ -0,0 +1,246 @@
+/*
+ * streaming line length statistics: the implementation
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "intlist.h"
+#include "chunklist.h"
+#include "reduce.h"
+#include "wordstats.h"
+
+
+#define BATCH	1024	/* line lengths summarised at a time */
+
+
+void init_wordstats( wordstats *w )
+{
+	init_intsummary( &w->s );
+	memset( w->hist, 0, sizeof(w->hist) );
+}
+
+
+void merge_wordstats( wordstats *w, wordstats *t )
+{
+	merge_intsummary( &w->s, &t->s );
+	int i;
+	for( i = 0; i <= WORDSTATS_MAXLEN; i++ )
+	{
+		w->hist[i] += t->hist[i];
+	}
+}
+
+
+/*
+ * While scanning, lines shorter than WORDSTATS_MAXLEN are just counted
+ * by length in nshort[]: the summary is worked out from those counts at
+ * the end.  Longer lines are batched up and summarised properly.
+ */
+typedef struct {
+	long	nshort[WORDSTATS_MAXLEN];
+	int	len[BATCH];		/* the long lines' lengths */
+	int	n;
+} scan;
+
+static void flush( wordstats *w, scan *sc )
+{
+	summarise_ints( &w->s, sc->len, sc->n );
+	w->hist[WORDSTATS_MAXLEN] += sc->n;
+	sc->n = 0;
+}
+
+static inline void addline( wordstats *w, scan *sc, size_t len )
+{
+	if( len < WORDSTATS_MAXLEN )
+	{
+		sc->nshort[len]++;
+		return;
+	}
+	sc->len[sc->n++] = len;
+	if( sc->n == BATCH )
+	{
+		flush( w, sc );
+	}
+}
+
+/* summarise the short lines' counts into w */
+static void addshort( wordstats *w, scan *sc )
+{
+	intsummary t;
+	init_intsummary( &t );
+	int len;
+	for( len = 0; len < WORDSTATS_MAXLEN; len++ )
+	{
+		long n = sc->nshort[len];
+		if( n > 0 )
+		{
+			t.count += n;
+			t.sum += n * len;
+			if( len < t.min )
+			{
+				t.min = len;
+			}
+			t.max = len;
+			w->hist[len] += n;
+		}
+	}
+	double mean = intsummary_mean( &t );
+	for( len = 0; len < WORDSTATS_MAXLEN; len++ )
+	{
+		double d = len - mean;
+		t.m2 += sc->nshort[len] * d * d;
+	}
+	merge_intsummary( &w->s, &t );
+}
+
+
+/*
+ * wordstats_buf( w, p, len );
+ *	Accumulate the lengths of the lines in p[0..len-1] into w.
+ *	A final line with no newline counts too.
+ */
+void wordstats_buf( wordstats *w, char *p, size_t len )
+{
+	scan sc;
+	memset( sc.nshort, 0, sizeof(sc.nshort) );
+	sc.n = 0;
+	size_t linestart = 0;
+	size_t i = 0;
+#ifdef __SSE2__
+	__m128i nl = _mm_set1_epi8( '\n' );
+	for( ; i + 16 <= len; i += 16 )
+	{
+		__m128i x = _mm_loadu_si128( (__m128i *)(p+i) );
+		unsigned mask = _mm_movemask_epi8( _mm_cmpeq_epi8( x, nl ) );
+		while( mask != 0 )
+		{
+			size_t pos = i + __builtin_ctz( mask );
+			addline( w, &sc, pos - linestart );
+			linestart = pos + 1;
+			mask &= mask - 1;
+		}
+	}
+#endif
+	for( ; i < len; i++ )
+	{
+		if( p[i] == '\n' )
+		{
+			addline( w, &sc, i - linestart );
+			linestart = i + 1;
+		}
+	}
+	if( linestart < len )
+	{
+		addline( w, &sc, len - linestart );
+	}
+	flush( w, &sc );
+	addshort( w, &sc );
+}
+
+
+typedef struct {		/* one thread's share of the file */
+	pthread_t	tid;
+	char *		p;
+	size_t		len;
+	wordstats	w;
+} part;
+
+static void *partthread( void *arg )
+{
+	part *pt = (part *)arg;
+	init_wordstats( &pt->w );
+	wordstats_buf( &pt->w, pt->p, pt->len );
+	return NULL;
+}
+
+
+/*
+ * bool ok = wordstats_file( w, path, nthreads );
+ *	Accumulate the lengths of the lines in file path into w,
+ *	using nthreads threads.  Return false if path can't be read.
+ */
+bool wordstats_file( wordstats *w, char *path, int nthreads )
+{
+	int fd = open( path, O_RDONLY );
+	if( fd < 0 )
+	{
+		return false;
+	}
+	struct stat st;
+	if( fstat( fd, &st ) < 0 )
+	{
+		close( fd );
+		return false;
+	}
+	size_t len = st.st_size;
+	if( len == 0 )
+	{
+		close( fd );
+		return true;
+	}
+	char *p = mmap( NULL, len, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+	if( p == MAP_FAILED )
+	{
+		return false;
+	}
+	madvise( p, len, MADV_SEQUENTIAL );
+
+	if( nthreads < 1 )
+	{
+		nthreads = 1;
+	}
+	if( (size_t)nthreads > len / 65536 + 1 )	/* not worth it */
+	{
+		nthreads = len / 65536 + 1;
+	}
+	part *pt = malloc( nthreads * sizeof(part) );
+	assert( pt != NULL );
+
+	/* split at line starts: each part begins just after a newline */
+	size_t start = 0;
+	int t;
+	for( t = 0; t < nthreads; t++ )
+	{
+		size_t end = len / nthreads * (t+1);
+		if( t == nthreads-1 || end < start )
+		{
+			end = len;
+		}
+		while( end < len && p[end-1] != '\n' )
+		{
+			end++;
+		}
+		pt[t].p = p + start;
+		pt[t].len = end - start;
+		start = end;
+	}
+	for( t = 1; t < nthreads; t++ )
+	{
+		int err = pthread_create( &pt[t].tid, NULL, partthread, &pt[t] );
+		assert( err == 0 );
+	}
+	partthread( &pt[0] );
+	merge_wordstats( w, &pt[0].w );
+	for( t = 1; t < nthreads; t++ )
+	{
+		pthread_join( pt[t].tid, NULL );
+		merge_wordstats( w, &pt[t].w );
+	}
+
+	free( pt );
+	munmap( p, len );
+	return true;
+}
@@ -0,0 +1,25 @@
+/*
+ * wordstats: a streaming, single pass "line length statistics" engine,
+ *	      for avgwordlen and friends: it mmaps a file, finds the
+ *	      newlines (16 bytes at a time with SSE2), and accumulates
+ *	      the count, sum, min, max and variance (an intsummary) and
+ *	      a histogram of the line lengths as it goes, in O(1) memory.
+ *
+ *	      wordstats_file() can split the file between several threads
+ *	      (at line boundaries), each summarising its own part, and
+ *	      then merges their partial results.
+ */
+
+#define WORDSTATS_MAXLEN	64	/* hist[] has buckets 0..MAXLEN, the */
+					/* last counting all longer lines */
+
+typedef struct {
+	intsummary	s;
+	long		hist[WORDSTATS_MAXLEN+1];
+} wordstats;
+
+
+extern void init_wordstats( wordstats * w );
+extern void wordstats_buf( wordstats * w, char * p, size_t len );
+extern void merge_wordstats( wordstats * w, wordstats * t );
+extern bool wordstats_file( wordstats * w, char * path, int nthreads );
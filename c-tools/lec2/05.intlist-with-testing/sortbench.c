@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "intlist.h"
+#include "defns.h"
+
+
+/*
+ * sortbench: time the intlist ordering operations on dictionary-sized
+ *	      inputs: the lengths of the words in the unix dictionary
+ *	      (or any other file of words), and as many pseudo-random ints.
+ *
+ *	usage: sortbench [wordfile]
+ */
+
+
+static double now( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static int cmpint( const void *a, const void *b )
+{
+	int x = *(const int *)a;
+	int y = *(const int *)b;
+	return (x > y) - (x < y);
+}
+
+
+/*
+ * bench( name, v, n );
+ *	Time each way of sorting a list of v[0..n-1], plus qsort() of
+ *	the array for comparison, and sort+dedupe and merge.
+ */
+static void bench( char *name, int *v, long n )
+{
+	intlist l;
+	long i;
+	double t;
+
+	printf( "%s: %ld elements\n", name, n );
+
+	int *a = malloc( n * sizeof(int) );
+	memcpy( a, v, n * sizeof(int) );
+	t = now();
+	qsort( a, n, sizeof(int), cmpint );
+	printf( "  qsort(array)      %8.4fs\n", now() - t );
+	free( a );
+
+	l = intlist_nil();
+	for( i = 0; i < n; i++ )
+	{
+		l = intlist_cons( v[i], l );
+	}
+	t = now();
+	l = mergesort_intlist( l );
+	printf( "  mergesort_intlist %8.4fs\n", now() - t );
+	free_intlist( l );
+
+	l = intlist_nil();
+	for( i = 0; i < n; i++ )
+	{
+		l = intlist_cons( v[i], l );
+	}
+	t = now();
+	l = radixsort_intlist( l );
+	printf( "  radixsort_intlist %8.4fs\n", now() - t );
+	t = now();
+	l = dedupe_intlist( l );
+	printf( "  dedupe_intlist    %8.4fs\n", now() - t );
+	free_intlist( l );
+
+	intlist odd = intlist_nil(), even = intlist_nil();
+	for( i = n-1; i >= 0; i-- )
+	{
+		if( i % 2 )
+		{
+			odd = intlist_cons( i, odd );
+		} else
+		{
+			even = intlist_cons( i, even );
+		}
+	}
+	t = now();
+	l = merge_intlist( odd, even );
+	printf( "  merge_intlist     %8.4fs\n", now() - t );
+	free_intlist( l );
+}
+
+
+int main( int argc, char **argv )
+{
+	char *file = argc > 1 ? argv[1] : DICTFILE;
+	FILE *dict = fopen( file, "r" );
+	if( dict == NULL )
+	{
+		fprintf( stderr, "Can't open dictionary file %s\n", file );
+		exit(1);
+	}
+	long n = 0, cap = 1024;
+	int *v = malloc( cap * sizeof(int) );
+	char line[1024];
+	while( fgets( line, 1024, dict ) != NULL )
+	{
+		int len = strlen(line);
+		if( line[len-1] == '\n' )
+		{
+			len--;
+		}
+		if( n == cap )
+		{
+			cap *= 2;
+			v = realloc( v, cap * sizeof(int) );
+		}
+		v[n++] = len;
+	}
+	fclose( dict );
+
+	bench( "word lengths", v, n );
+
+	unsigned x = 1;
+	long i;
+	for( i = 0; i < n; i++ )
+	{
+		x = x * 1103515245 + 12345;
+		v[i] = (int)x;
+	}
+	bench( "random ints", v, n );
+
+	free( v );
+	return(0);
+}
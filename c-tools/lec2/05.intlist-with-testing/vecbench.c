@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "intlist.h"
+#include "chunklist.h"
+#include "intvec.h"
+#include "defns.h"
+
+
+/*
+ * vecbench: compare intlist, chunklist and intvec on the avgwordlen
+ *	     workload (append every word's length, then scan them all
+ *	     to sum them, then free), at several build sizes made by
+ *	     cycling through the lengths of the words in the unix
+ *	     dictionary (or any other file of words).
+ *
+ *	usage: vecbench [wordfile]
+ */
+
+
+static double now( void )
+{
+	struct timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+
+static void sumcb( int el, void *sumsofar )
+{
+	long *sum = (long *)sumsofar;
+	(*sum) += el;
+}
+
+
+static void report( char *name, long n, double build, double scan,
+		    double freed, long sum )
+{
+	printf( "%-10s %9ld %9.4f %9.4f %9.4f %9.1f  %ld\n", name, n,
+		build, scan, freed, n / (build + scan + freed) / 1e6, sum );
+}
+
+
+int main( int argc, char **argv )
+{
+	char *file = argc > 1 ? argv[1] : DICTFILE;
+	FILE *dict = fopen( file, "r" );
+	if( dict == NULL )
+	{
+		fprintf( stderr, "Can't open dictionary file %s\n", file );
+		exit(1);
+	}
+	intvec words = new_intvec();
+	char line[1024];
+	while( fgets( line, 1024, dict ) != NULL )
+	{
+		int len = strlen(line);
+		if( line[len-1] == '\n' )
+		{
+			len--;
+		}
+		intvec_push( words, len );
+	}
+	fclose( dict );
+	long nwords = intvec_len(words);
+	if( nwords == 0 )
+	{
+		fprintf( stderr, "No words in %s\n", file );
+		exit(1);
+	}
+
+	printf( "%-10s %9s %9s %9s %9s %9s  %s\n", "type", "n",
+		"build", "scan", "free", "Mints/s", "sum" );
+	long sizes[] = { 10000, 100000, 1000000, 4000000 };
+	int s;
+	for( s = 0; s < sizeof(sizes)/sizeof(sizes[0]); s++ )
+	{
+		long n = sizes[s];
+		long i, sum;
+		double t0, t1, t2;
+
+		t0 = now();
+		intlist l = intlist_nil();
+		for( i = 0; i < n; i++ )
+		{
+			l = intlist_cons( intvec_get( words, i % nwords ), l );
+		}
+		t1 = now();
+		sum = 0;
+		foreach_intlist( sumcb, &sum, l );
+		t2 = now();
+		free_intlist( l );
+		report( "intlist", n, t1-t0, t2-t1, now()-t2, sum );
+
+		t0 = now();
+		chunklist c = chunklist_nil();
+		for( i = 0; i < n; i++ )
+		{
+			c = chunklist_cons( intvec_get( words, i % nwords ), c );
+		}
+		t1 = now();
+		sum = 0;
+		foreach_chunklist( sumcb, &sum, c );
+		t2 = now();
+		free_chunklist( c );
+		report( "chunklist", n, t1-t0, t2-t1, now()-t2, sum );
+
+		t0 = now();
+		intvec v = new_intvec();
+		for( i = 0; i < n; i++ )
+		{
+			intvec_push( v, intvec_get( words, i % nwords ) );
+		}
+		t1 = now();
+		sum = 0;
+		foreach_intvec( sumcb, &sum, v );
+		t2 = now();
+		free_intvec( v );
+		report( "intvec", n, t1-t0, t2-t1, now()-t2, sum );
+	}
+
+	free_intvec( words );
+	return(0);
+}